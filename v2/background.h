@@ -0,0 +1,156 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Background Jobs: deferrable work without a deadline.
+//
+// Queuing housekeeping with QueueJob at now() puts it in the ordered queue of the timed Jobs,
+// where it is dispatched ahead of any timed Job that falls due while it waits. Background
+// Jobs instead wait in a BackgroundQueue of their own, in FIFO order, and only ever reach the
+// ordered queue through a runner: a Job of the Pool that runs background Jobs one after the
+// other, as long as no timed Job is due within the horizon. Once one is, the runner queues
+// itself again for one horizon past that timed Job, and gives its worker back.
+//
+// A background Job gets a BackgroundCheck and should call ShouldYield() between chunks of its
+// work; if that returns true, it returns false (not done), and is resumed later, before the
+// other background Jobs. ShouldYield() is a clock read and two relaxed loads: the Pool keeps
+// the earliest timed time_point in an atomic, lowered by every AddJob while background Jobs
+// are in use, and refreshed from the queue by the runner.
+//
+// There is a single runner, so background Jobs take up at most one worker at a time, and the
+// other workers are free for the timed Jobs that fall due during a chunk. (A second runner
+// waiting in the ordered queue would look like a due timed Job to the first.)
+//
+struct BackgroundOptions
+{
+  std::chrono::microseconds horizon{1000}; // No background Job starts (or keeps going) this close to a timed one
+};
+
+//
+// Cooperative preemption check of a running background Job.
+//
+class BackgroundCheck
+{
+public:
+  BackgroundCheck(const std::atomic<int64_t> &next_due_ns, int64_t horizon_ns, const std::atomic_bool &stop,
+                  Task::time_point_t (*now)())
+    : next_due_ns_(next_due_ns), horizon_ns_(horizon_ns), stop_(stop), now_(now)
+  {
+  }
+
+  //
+  // @brief: True once a timed Job is due within the horizon, or the Pool is stopping: the
+  //    background Job should return false at its next chunk boundary.
+  //
+  bool ShouldYield() const
+  {
+    const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now_().time_since_epoch()).count();
+    return stop_.load(std::memory_order_relaxed) || now_ns + horizon_ns_ >= next_due_ns_.load(std::memory_order_relaxed);
+  }
+
+private:
+  const std::atomic<int64_t> &next_due_ns_;
+  const int64_t horizon_ns_;
+  const std::atomic_bool &stop_;
+  Task::time_point_t (*const now_)();
+};
+
+//
+// A background Job returns true once it is done, false if it yielded and must be resumed.
+//
+using BackgroundJob = std::function<bool(const BackgroundCheck &)>;
+
+//
+// BackgroundQueue: FIFO of the background Jobs, and whether their runner exists.
+//
+class BackgroundQueue
+{
+public:
+  //
+  // @brief: Queue job. Returns true if the caller must start the runner.
+  //
+  bool Push(BackgroundJob &&job)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+    if (runner_)
+    {
+      return false;
+    }
+    runner_ = true;
+    return true;
+  }
+
+  //
+  // @brief: Put a Job that yielded back, to be resumed before the others.
+  //
+  void Resume(BackgroundJob &&job)
+  {
+    preempted_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_front(std::move(job));
+  }
+
+  //
+  // @brief: The next Job for a runner. An empty function if there is none: the runner is
+  //    retired, and the next Push starts a new one.
+  //
+  BackgroundJob Pop()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (jobs_.empty())
+    {
+      runner_ = false;
+      return BackgroundJob();
+    }
+    BackgroundJob job = std::move(jobs_.front());
+    jobs_.pop_front();
+    return job;
+  }
+
+  void Completed()
+  {
+    completed_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //
+  // @brief: Drop every Job. The runner must be gone with the queue of the Pool.
+  //
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.clear();
+    runner_ = false;
+  }
+
+  size_t size() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+  }
+
+  uint64_t completed() const { return completed_.load(std::memory_order_relaxed); }
+  uint64_t preempted() const { return preempted_.load(std::memory_order_relaxed); }
+
+private:
+  mutable std::mutex mutex_; // Guards jobs_ and runner_
+  std::deque<BackgroundJob> jobs_;
+  bool runner_{false}; // The runner is queued in the Pool, or running
+  std::atomic<uint64_t> completed_{0}; // Jobs that returned true
+  std::atomic<uint64_t> preempted_{0}; // Times a Job yielded
+};
+} // namespace job_manager
+} // namespace vm
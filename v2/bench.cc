@@ -0,0 +1,969 @@
+#include "job_manager.h"
+#include "lazy_list.h"
+#include "list.h"
+#include "time_point_task.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using vm::job_manager::JobManager;
+using vm::job_manager::LazyOrderedList;
+using vm::job_manager::RealtimeJobManager;
+using vm::job_manager::RealtimeOptions;
+using vm::job_manager::Task;
+using vm::job_manager::ThreadSafeOrderedList;
+
+namespace
+{
+using nanoseconds = std::chrono::nanoseconds;
+
+//
+// Element of the containers under test: a time_point, and an id unique within a run, so
+// that the history of a run tells which insert every pop returned.
+//
+struct Key
+{
+  Task::time_point_t time_point;
+  uint32_t id{0};
+
+  const Task::time_point_t &GetRunTimePoint() const { return time_point; }
+  bool operator<(const Key &other) const { return time_point < other.time_point; }
+  bool operator<=(const Key &other) const { return time_point <= other.time_point; }
+};
+
+//
+// The containers under test, behind insert and a pop of the earliest Key.
+//
+
+//
+// Version-0: a multiset under one mutex, the way SetQueue is used with CondVarWait.
+//
+class MutexSet
+{
+public:
+  void insert(const Key &key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    keys_.insert(key);
+  }
+
+  bool pop(Key &key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keys_.empty())
+    {
+      return false;
+    }
+    key = std::move(keys_.extract(keys_.begin()).value());
+    return true;
+  }
+
+private:
+  std::mutex mutex_;
+  std::multiset<Key> keys_;
+};
+
+//
+// Version-1: ThreadSafeOrderedList (hand-over-hand), or LazyOrderedList.
+//
+template <typename List>
+class OrderedList
+{
+public:
+  void insert(const Key &key)
+  {
+    list_.insert(key);
+  }
+
+  bool pop(Key &key)
+  {
+    const std::unique_ptr<Key> first = list_.pop();
+    if (!first)
+    {
+      return false;
+    }
+    key = *first;
+    return true;
+  }
+
+private:
+  List list_;
+};
+
+using HandOverHandList = OrderedList<ThreadSafeOrderedList<Key>>;
+using LazyList = OrderedList<LazyOrderedList<Key>>;
+
+enum class Distribution
+{
+  kAscending, // Every insert behind the others: the longest walk for the lists
+  kDescending, // Every insert in front of the others
+  kRandom, // Uniform over a wide range
+  kClustered, // Around 8 hot deadlines, 1us wide
+  kDuplicates, // 16 distinct deadlines only
+};
+
+constexpr std::pair<Distribution, const char *> kDistributions[] = {
+  {Distribution::kAscending, "ascending"},
+  {Distribution::kDescending, "descending"},
+  {Distribution::kRandom, "random"},
+  {Distribution::kClustered, "clustered"},
+  {Distribution::kDuplicates, "duplicates"},
+};
+
+const char *Name(Distribution distribution)
+{
+  for (const auto &[value, name] : kDistributions)
+  {
+    if (value == distribution)
+    {
+      return name;
+    }
+  }
+  return "?";
+}
+
+//
+// @brief: time_point of the sequence-th Key of a run (the prefill comes first, then the
+//    writers interleaved).
+//
+Task::time_point_t MakeTimePoint(Distribution distribution, uint64_t sequence, std::mt19937_64 &rng)
+{
+  constexpr int64_t kBase = int64_t{1} << 50;
+  int64_t offset = 0;
+  switch (distribution)
+  {
+  case Distribution::kAscending:
+    offset = static_cast<int64_t>(sequence) * 1000;
+    break;
+  case Distribution::kDescending:
+    offset = -static_cast<int64_t>(sequence) * 1000;
+    break;
+  case Distribution::kRandom:
+    offset = static_cast<int64_t>(rng() % (uint64_t{1} << 40));
+    break;
+  case Distribution::kClustered:
+    offset = static_cast<int64_t>(rng() % 8) * (int64_t{1} << 36) + static_cast<int64_t>(rng() % 1000);
+    break;
+  case Distribution::kDuplicates:
+    offset = static_cast<int64_t>(rng() % 16) * 1000000;
+    break;
+  }
+  return Task::time_point_t(nanoseconds(kBase + offset));
+}
+
+//
+// One cell of the matrix.
+//
+struct Cell
+{
+  Distribution distribution{Distribution::kRandom};
+  size_t prefill{0}; // Keys inserted before the threads start
+  size_t readers{1}; // Threads that pop
+  size_t writers{1}; // Threads that insert
+};
+
+//
+// One completed operation of a run, for the linearizability check.
+//
+struct Operation
+{
+  enum Kind : uint8_t
+  {
+    kInsert,
+    kPop,
+    kEmptyPop, // pop found the container empty
+  };
+
+  Kind kind;
+  uint32_t id; // Key inserted or popped
+  int64_t time_point_ns; // Its time_point
+  int64_t call_ns; // Clock read before the call
+  int64_t return_ns; // Clock read after it returned
+};
+
+//
+// LinearizabilityChecker: is a concurrent history of a priority queue linearizable?
+//
+// The sequential specification: insert adds its Key; pop returns a Key with the earliest
+// time_point present (any of them, among equal time_points) and removes it; an empty pop
+// only happens on an empty container.
+//
+// The search is the one of Wing & Gong with Lowe's just-in-time linearization, as in
+// porcupine: walk the calls and returns in time order; at a call, try to linearize that
+// operation next (apply it to the model, lift it out of the history, start over); at a return
+// whose operation is not linearized yet, undo the last choice and try the next call. The set
+// of linearized operations determines the model state, so a set that has been tried once is
+// never tried again. Histories of fast operations on a few threads rarely backtrack; the step
+// budget bounds the rest.
+//
+class LinearizabilityChecker
+{
+public:
+  enum class Result
+  {
+    kLinearizable,
+    kNotLinearizable,
+    kInconclusive, // Step budget exhausted
+  };
+
+  LinearizabilityChecker(const std::vector<Operation> &history, const std::vector<std::pair<int64_t, uint32_t>> &initial)
+    : history_(history), state_(initial.begin(), initial.end()), linearized_((history.size() + 63) / 64, 0)
+  {
+    events_.reserve(2 * history.size() + 1);
+    events_.push_back(Event{}); // Sentinel head
+    std::vector<Event> sorted;
+    sorted.reserve(2 * history.size());
+    for (size_t i = 0; i < history.size(); ++i)
+    {
+      sorted.push_back(Event{true, i, history[i].call_ns});
+      sorted.push_back(Event{false, i, history[i].return_ns});
+    }
+    // Calls before returns at the same clock reading: those operations overlap.
+    std::sort(sorted.begin(), sorted.end(), [](const Event &a, const Event &b) {
+      return a.time_ns < b.time_ns || (a.time_ns == b.time_ns && a.call && !b.call);
+    });
+    std::vector<size_t> call_of(history.size());
+    for (const Event &event : sorted)
+    {
+      events_.push_back(event);
+      const size_t index = events_.size() - 1;
+      events_[index].prev = index - 1;
+      events_[index - 1].next = index;
+      if (event.call)
+      {
+        call_of[event.operation] = index;
+      }
+      else
+      {
+        events_[call_of[event.operation]].match = index;
+      }
+    }
+  }
+
+  Result Check(uint64_t max_steps)
+  {
+    std::vector<size_t> stack; // Calls linearized, in order
+    size_t entry = events_[0].next;
+    uint64_t steps = 0;
+    while (events_[0].next != kNone)
+    {
+      if (++steps > max_steps)
+      {
+        return Result::kInconclusive;
+      }
+      if (entry == kNone)
+      {
+        return Result::kNotLinearizable;
+      }
+      const Event &event = events_[entry];
+      if (event.call)
+      {
+        if (Apply(event.operation))
+        {
+          Set(event.operation, true);
+          if (tried_.insert(linearized_).second)
+          {
+            stack.push_back(entry);
+            Lift(entry);
+            entry = events_[0].next;
+            continue;
+          }
+          Set(event.operation, false);
+          Undo(event.operation);
+        }
+        entry = event.next;
+      }
+      else
+      {
+        // An operation returned that cannot be linearized before it: backtrack.
+        if (stack.empty())
+        {
+          return Result::kNotLinearizable;
+        }
+        const size_t top = stack.back();
+        stack.pop_back();
+        Set(events_[top].operation, false);
+        Undo(events_[top].operation);
+        Unlift(top);
+        entry = events_[top].next;
+      }
+    }
+    return Result::kLinearizable;
+  }
+
+private:
+  static constexpr size_t kNone = SIZE_MAX;
+
+  struct Event
+  {
+    bool call{false};
+    size_t operation{0};
+    int64_t time_ns{0};
+    size_t prev{kNone};
+    size_t next{kNone};
+    size_t match{kNone}; // Return of a call
+  };
+
+  struct BitsHash
+  {
+    size_t operator()(const std::vector<uint64_t> &bits) const
+    {
+      uint64_t hash = 14695981039346656037ULL;
+      for (const uint64_t word : bits)
+      {
+        hash = (hash ^ word) * 1099511628211ULL;
+      }
+      return hash;
+    }
+  };
+
+  bool Apply(size_t index)
+  {
+    const Operation &operation = history_[index];
+    switch (operation.kind)
+    {
+    case Operation::kInsert:
+      state_.emplace(operation.time_point_ns, operation.id);
+      return true;
+    case Operation::kPop:
+      if (state_.empty() || state_.begin()->first != operation.time_point_ns
+          || !state_.erase({operation.time_point_ns, operation.id}))
+      {
+        return false;
+      }
+      return true;
+    case Operation::kEmptyPop:
+      return state_.empty();
+    }
+    return false;
+  }
+
+  void Undo(size_t index)
+  {
+    const Operation &operation = history_[index];
+    if (operation.kind == Operation::kInsert)
+    {
+      state_.erase({operation.time_point_ns, operation.id});
+    }
+    else if (operation.kind == Operation::kPop)
+    {
+      state_.emplace(operation.time_point_ns, operation.id);
+    }
+  }
+
+  void Set(size_t index, bool value)
+  {
+    if (value)
+    {
+      linearized_[index / 64] |= uint64_t{1} << (index % 64);
+    }
+    else
+    {
+      linearized_[index / 64] &= ~(uint64_t{1} << (index % 64));
+    }
+  }
+
+  void Unlink(size_t index)
+  {
+    Event &event = events_[index];
+    events_[event.prev].next = event.next;
+    if (event.next != kNone)
+    {
+      events_[event.next].prev = event.prev;
+    }
+  }
+
+  void Relink(size_t index)
+  {
+    Event &event = events_[index];
+    events_[event.prev].next = index;
+    if (event.next != kNone)
+    {
+      events_[event.next].prev = index;
+    }
+  }
+
+  void Lift(size_t call)
+  {
+    Unlink(call);
+    Unlink(events_[call].match);
+  }
+
+  void Unlift(size_t call)
+  {
+    Relink(events_[call].match);
+    Relink(call);
+  }
+
+  const std::vector<Operation> &history_;
+  std::vector<Event> events_; // Sentinel, then calls and returns in time order, linked
+  std::set<std::pair<int64_t, uint32_t>> state_; // Model: (time_point, id) present
+  std::vector<uint64_t> linearized_; // Bit per operation of history_
+  std::unordered_set<std::vector<uint64_t>, BitsHash> tried_; // Linearized sets seen so far
+};
+
+//
+// Hardware cache misses of the process (the calling thread and the threads it starts from
+// now on), through perf_event_open. Unavailable without a PMU or with perf_event_paranoid
+// too high, which is common in containers: the numbers are then left out.
+//
+class CacheMissCounter
+{
+public:
+  CacheMissCounter()
+  {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    if (fd_ < 0)
+    {
+      error_ = std::strerror(errno);
+    }
+  }
+
+  ~CacheMissCounter()
+  {
+    if (fd_ >= 0)
+    {
+      close(fd_);
+    }
+  }
+
+  CacheMissCounter(const CacheMissCounter &other) = delete;
+  CacheMissCounter &operator=(const CacheMissCounter &other) = delete;
+
+  bool available() const { return fd_ >= 0; }
+  const std::string &error() const { return error_; }
+
+  void Start()
+  {
+    if (fd_ >= 0)
+    {
+      ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  //
+  // @brief: Misses since Start, -1 if unavailable. The threads started since must have been
+  //    joined: their counts are added to ours when they exit.
+  //
+  int64_t Stop()
+  {
+    uint64_t count = 0;
+    if (fd_ < 0)
+    {
+      return -1;
+    }
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd_, &count, sizeof(count)) != sizeof(count))
+    {
+      return -1;
+    }
+    return static_cast<int64_t>(count);
+  }
+
+private:
+  int fd_{-1};
+  std::string error_; // Why perf_event_open failed
+};
+
+struct Result
+{
+  uint64_t operations{0};
+  double seconds{0}; // Wall time from the start of the threads to the last one done
+  std::vector<int64_t> insert_ns; // Sorted
+  std::vector<int64_t> pop_ns; // Sorted, empty pops included
+  uint64_t empty_pops{0};
+  int64_t cache_misses{-1}; // -1 if unavailable
+  bool passed{true}; // Conserved, and not found non-linearizable
+  std::string check; // Outcome of the conservation and linearizability checks
+};
+
+int64_t Now()
+{
+  return std::chrono::duration_cast<nanoseconds>(Task::clock_t::now().time_since_epoch()).count();
+}
+
+int64_t Nanoseconds(const Task::time_point_t &time_point)
+{
+  return std::chrono::duration_cast<nanoseconds>(time_point.time_since_epoch()).count();
+}
+
+//
+// @brief: Run cell on a fresh Container: prefill it, then start the readers and writers on
+//    a barrier, every thread doing ops operations, each one timed. Then drain the container
+//    and check that every Key came out exactly once, and (with check) that the history of
+//    the concurrent phase is linearizable.
+//
+template <typename Container>
+Result Run(const Cell &cell, size_t ops, bool check, uint64_t max_steps, CacheMissCounter &misses)
+{
+  Container container;
+  std::mt19937_64 rng(42);
+  std::vector<std::pair<int64_t, uint32_t>> initial;
+  initial.reserve(cell.prefill);
+  for (size_t i = 0; i < cell.prefill; ++i)
+  {
+    const Key key{MakeTimePoint(cell.distribution, i, rng), static_cast<uint32_t>(i)};
+    container.insert(key);
+    initial.emplace_back(Nanoseconds(key.time_point), key.id);
+  }
+
+  const size_t threads = cell.readers + cell.writers;
+  std::vector<std::vector<Operation>> histories(threads);
+  std::vector<std::vector<int64_t>> latencies(threads);
+  std::atomic<size_t> ready{0};
+  std::atomic<uint64_t> empty_pops{0};
+
+  misses.Start();
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&, t]() {
+      const bool writer = t < cell.writers;
+      std::vector<Operation> &history = histories[t];
+      std::vector<int64_t> &latency = latencies[t];
+      history.reserve(ops);
+      latency.reserve(ops);
+      std::mt19937_64 thread_rng(t + 1);
+      ready.fetch_add(1);
+      while (ready.load() < threads)
+      {
+        std::this_thread::yield();
+      }
+
+      uint64_t empty = 0;
+      for (size_t i = 0; i < ops; ++i)
+      {
+        if (writer)
+        {
+          const uint64_t sequence = cell.prefill + i * cell.writers + t;
+          const Key key{MakeTimePoint(cell.distribution, sequence, thread_rng), static_cast<uint32_t>(sequence)};
+          const int64_t call = Now();
+          container.insert(key);
+          const int64_t ret = Now();
+          latency.push_back(ret - call);
+          history.push_back({Operation::kInsert, key.id, Nanoseconds(key.time_point), call, ret});
+        }
+        else
+        {
+          Key key;
+          const int64_t call = Now();
+          const bool popped = container.pop(key);
+          const int64_t ret = Now();
+          latency.push_back(ret - call);
+          if (popped)
+          {
+            history.push_back({Operation::kPop, key.id, Nanoseconds(key.time_point), call, ret});
+          }
+          else
+          {
+            history.push_back({Operation::kEmptyPop, 0, 0, call, ret});
+            ++empty;
+          }
+        }
+      }
+      empty_pops.fetch_add(empty);
+    });
+  }
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+
+  Result result;
+  result.cache_misses = misses.Stop();
+  result.operations = threads * ops;
+  result.empty_pops = empty_pops.load();
+  // From the first call to the last return: on few cores the threads may well be done before
+  // this one gets to look at the clock.
+  int64_t start = INT64_MAX;
+  int64_t end = INT64_MIN;
+  for (size_t t = 0; t < threads; ++t)
+  {
+    if (!histories[t].empty())
+    {
+      start = std::min(start, histories[t].front().call_ns);
+      end = std::max(end, histories[t].back().return_ns);
+    }
+  }
+  result.seconds = end > start ? (end - start) / 1e9 : 0;
+  for (size_t t = 0; t < threads; ++t)
+  {
+    std::vector<int64_t> &sorted = t < cell.writers ? result.insert_ns : result.pop_ns;
+    sorted.insert(sorted.end(), latencies[t].begin(), latencies[t].end());
+  }
+  std::sort(result.insert_ns.begin(), result.insert_ns.end());
+  std::sort(result.pop_ns.begin(), result.pop_ns.end());
+
+  // Conservation: every Key inserted comes out exactly once, the rest in order on the drain.
+  const size_t inserted = cell.prefill + cell.writers * ops;
+  std::vector<uint8_t> seen(inserted, 0);
+  size_t duplicates = 0;
+  size_t unknown = 0;
+  const auto see = [&](uint32_t id) {
+    if (id >= inserted)
+    {
+      ++unknown;
+    }
+    else if (seen[id]++)
+    {
+      ++duplicates;
+    }
+  };
+  for (size_t t = cell.writers; t < threads; ++t)
+  {
+    for (const Operation &operation : histories[t])
+    {
+      if (operation.kind == Operation::kPop)
+      {
+        see(operation.id);
+      }
+    }
+  }
+  size_t out_of_order = 0;
+  Key key;
+  Task::time_point_t last = Task::time_point_t::min();
+  while (container.pop(key))
+  {
+    out_of_order += key.time_point < last;
+    last = key.time_point;
+    see(key.id);
+  }
+  const size_t lost = static_cast<size_t>(std::count(seen.begin(), seen.end(), 0));
+
+  std::ostringstream outcome;
+  if (lost || duplicates || unknown || out_of_order)
+  {
+    result.passed = false;
+    outcome << "FAILED: " << lost << " lost, " << duplicates << " duplicated, " << unknown << " unknown, "
+            << out_of_order << " out of order";
+  }
+  else if (!check)
+  {
+    outcome << "conserved";
+  }
+  else
+  {
+    std::vector<Operation> history;
+    history.reserve(result.operations);
+    for (const std::vector<Operation> &thread_history : histories)
+    {
+      history.insert(history.end(), thread_history.begin(), thread_history.end());
+    }
+    switch (LinearizabilityChecker(history, initial).Check(max_steps))
+    {
+    case LinearizabilityChecker::Result::kLinearizable:
+      outcome << "linearizable";
+      break;
+    case LinearizabilityChecker::Result::kNotLinearizable:
+      result.passed = false;
+      outcome << "NOT LINEARIZABLE";
+      break;
+    case LinearizabilityChecker::Result::kInconclusive:
+      outcome << "conserved, linearizability inconclusive";
+      break;
+    }
+  }
+  result.check = outcome.str();
+  return result;
+}
+
+double Percentile(const std::vector<int64_t> &sorted, double quantile)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+  const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(quantile * sorted.size()));
+  return static_cast<double>(sorted[index]);
+}
+
+void Print(const std::string &container, const Cell &cell, const Result &result)
+{
+  std::printf("%-5s %-10s prefill %6zu r%zu w%zu %11.0f ops/s  insert(ns) p50 %7.0f p99 %8.0f max %9.0f"
+              "  pop(ns) p50 %7.0f p99 %8.0f max %9.0f  empty %6llu",
+              container.c_str(), Name(cell.distribution), cell.prefill, cell.readers, cell.writers,
+              result.seconds > 0 ? result.operations / result.seconds : 0.0,
+              Percentile(result.insert_ns, 0.5), Percentile(result.insert_ns, 0.99),
+              result.insert_ns.empty() ? 0.0 : static_cast<double>(result.insert_ns.back()),
+              Percentile(result.pop_ns, 0.5), Percentile(result.pop_ns, 0.99),
+              result.pop_ns.empty() ? 0.0 : static_cast<double>(result.pop_ns.back()),
+              static_cast<unsigned long long>(result.empty_pops));
+  if (result.cache_misses >= 0)
+  {
+    std::printf("  misses/op %7.1f", static_cast<double>(result.cache_misses) / result.operations);
+  }
+  std::printf("  %s\n", result.check.c_str());
+}
+
+//
+// @brief: Comma-separated list of sizes ("0,1000,10000").
+//
+std::vector<size_t> ParseSizes(const std::string &list)
+{
+  std::vector<size_t> sizes;
+  std::istringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+  {
+    sizes.push_back(std::stoul(item));
+  }
+  return sizes;
+}
+
+//
+// Real-time report (--realtime): lateness of a periodic 1ms timer. The Jobs only record how
+// late they start, so the numbers are the jitter of the dispatch path alone.
+//
+constexpr size_t kPeriodicJobs = 5000;
+constexpr int kRealtimePriority = 50;
+
+void PrintLateness(const char *name, std::vector<int64_t> &late_ns)
+{
+  std::sort(late_ns.begin(), late_ns.end());
+  std::printf("%-8s late(us) min %7.1f p50 %7.1f p99 %7.1f p99.9 %7.1f max %7.1f jitter %7.1f\n",
+              name, late_ns.front() / 1e3, Percentile(late_ns, 0.5) / 1e3, Percentile(late_ns, 0.99) / 1e3,
+              Percentile(late_ns, 0.999) / 1e3, late_ns.back() / 1e3, (late_ns.back() - late_ns.front()) / 1e3);
+}
+
+template <typename Manager>
+std::vector<int64_t> Periodic(Manager &scheduler)
+{
+  const std::chrono::milliseconds period(1);
+  std::vector<int64_t> late_ns(kPeriodicJobs);
+  std::atomic<size_t> executed{0};
+
+  scheduler.Start();
+  const auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+  for (size_t i = 0; i < kPeriodicJobs; ++i)
+  {
+    const auto tp = start + i * period;
+    scheduler.TryQueueJob(tp, [tp, i, &late_ns, &executed]() {
+      late_ns[i] = std::chrono::duration_cast<nanoseconds>(std::chrono::steady_clock::now() - tp).count();
+      ++executed;
+    });
+  }
+  while (executed.load() < kPeriodicJobs)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  scheduler.End();
+  return late_ns;
+}
+
+//
+// @brief: The floor of the machine: one thread, set up like a real-time worker, that does
+//    nothing but sleep_until the same deadlines. Whatever lateness it sees (the scheduler,
+//    the hypervisor) no Pool can take out; the gap to it is what the Pool adds.
+//
+std::vector<int64_t> Floor()
+{
+  std::vector<int64_t> late_ns(kPeriodicJobs);
+  std::thread thread([&late_ns]() {
+    std::string error;
+    vm::job_manager::PrepareRealtimeThread(kRealtimePriority, error);
+    const auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+    for (size_t i = 0; i < kPeriodicJobs; ++i)
+    {
+      const auto tp = start + i * std::chrono::milliseconds(1);
+      std::this_thread::sleep_until(tp);
+      late_ns[i] = std::chrono::duration_cast<nanoseconds>(std::chrono::steady_clock::now() - tp).count();
+    }
+  });
+  thread.join();
+  return late_ns;
+}
+
+//
+// @brief: The default JobManager against the RealtimeJobManager (one SCHED_FIFO dispatcher
+//    on a priority-inheriting queue mutex, where permitted), and the floor of the machine.
+//
+void RealtimeReport()
+{
+  {
+    JobManager scheduler;
+    std::vector<int64_t> late_ns = Periodic(scheduler);
+    PrintLateness("default", late_ns);
+  }
+  RealtimeJobManager scheduler;
+  RealtimeOptions options;
+  options.capacity = 8192;
+  options.priorities = {kRealtimePriority};
+  scheduler.SetRealtime(options);
+  std::vector<int64_t> late_ns = Periodic(scheduler);
+  PrintLateness("realtime", late_ns);
+  late_ns = Floor();
+  PrintLateness("floor", late_ns);
+  std::cout << scheduler.Realtime().format();
+}
+} // namespace
+
+//
+// Usage: ./bench [--ops <n>] [--threads <r:w,...>] [--prefill <n,...>] [--distribution <name,...>] [--max-steps <n>] [--no-check] [set|list|lazy ...]
+//        ./bench --realtime
+//    Runs the ordered containers alone, without a TaskPool or any sleeping, over a matrix of
+//    reader:writer thread counts (1:1,2:2,1:3,3:1 by default), pre-fill sizes (0,1000,10000)
+//    and key distributions (ascending, descending, random, clustered, duplicates; all by
+//    default). Every thread does --ops operations (2000): writers insert, readers pop.
+//    set is the Version-0 multiset under a mutex, list the Version-1 hand-over-hand
+//    ThreadSafeOrderedList, lazy the LazyOrderedList.
+//    Reports ops/s, the latency percentiles of insert and pop, the pops that found the
+//    container empty and, where perf_event_open is permitted, cache misses per operation.
+//    Every run is checked: each Key comes out exactly once, and the recorded history is
+//    linearizable for a priority queue (--no-check skips the latter, --max-steps bounds it).
+//    --realtime reports the worst-case lateness of a periodic 1ms timer instead: the default
+//    backend, the real-time one (realtime.h) and the floor of the machine.
+//
+int main(int argc, char *argv[])
+{
+  size_t ops = 2000;
+  uint64_t max_steps = 10000000;
+  bool check = true;
+  std::vector<std::pair<size_t, size_t>> threads = {{1, 1}, {2, 2}, {1, 3}, {3, 1}};
+  std::vector<size_t> prefills = {0, 1000, 10000};
+  std::vector<Distribution> distributions;
+  std::vector<std::string> containers;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--ops" && i + 1 < argc)
+    {
+      ops = std::stoul(argv[++i]);
+    }
+    else if (arg == "--max-steps" && i + 1 < argc)
+    {
+      max_steps = std::stoull(argv[++i]);
+    }
+    else if (arg == "--no-check")
+    {
+      check = false;
+    }
+    else if (arg == "--realtime")
+    {
+      RealtimeReport();
+      return 0;
+    }
+    else if (arg == "--prefill" && i + 1 < argc)
+    {
+      prefills = ParseSizes(argv[++i]);
+    }
+    else if (arg == "--threads" && i + 1 < argc)
+    {
+      threads.clear();
+      std::istringstream stream(argv[++i]);
+      std::string item;
+      while (std::getline(stream, item, ','))
+      {
+        const size_t colon = item.find(':');
+        if (colon == std::string::npos)
+        {
+          std::cerr << "--threads takes readers:writers pairs, not " << item << std::endl;
+          return 1;
+        }
+        threads.emplace_back(std::stoul(item.substr(0, colon)), std::stoul(item.substr(colon + 1)));
+      }
+    }
+    else if (arg == "--distribution" && i + 1 < argc)
+    {
+      std::istringstream stream(argv[++i]);
+      std::string item;
+      while (std::getline(stream, item, ','))
+      {
+        const auto found = std::find_if(std::begin(kDistributions), std::end(kDistributions),
+                                        [&item](const auto &entry) { return item == entry.second; });
+        if (found == std::end(kDistributions))
+        {
+          std::cerr << "Unknown distribution " << item << std::endl;
+          return 1;
+        }
+        distributions.push_back(found->first);
+      }
+    }
+    else
+    {
+      containers.push_back(arg);
+    }
+  }
+  if (distributions.empty())
+  {
+    for (const auto &[distribution, name] : kDistributions)
+    {
+      distributions.push_back(distribution);
+    }
+  }
+  if (containers.empty())
+  {
+    containers = {"set", "list", "lazy"};
+  }
+
+  CacheMissCounter misses;
+  if (!misses.available())
+  {
+    std::cout << "Cache misses not reported: perf_event_open: " << misses.error() << std::endl;
+  }
+
+  bool failed = false;
+  for (const std::string &container : containers)
+  {
+    for (const Distribution distribution : distributions)
+    {
+      for (const size_t prefill : prefills)
+      {
+        for (const auto &[readers, writers] : threads)
+        {
+          const Cell cell{distribution, prefill, readers, writers};
+          Result result;
+          if (container == "set")
+          {
+            result = Run<MutexSet>(cell, ops, check, max_steps, misses);
+          }
+          else if (container == "list")
+          {
+            result = Run<HandOverHandList>(cell, ops, check, max_steps, misses);
+          }
+          else if (container == "lazy")
+          {
+            result = Run<LazyList>(cell, ops, check, max_steps, misses);
+          }
+          else
+          {
+            std::cerr << "Unknown container " << container << std::endl;
+            return 1;
+          }
+          Print(container, cell, result);
+          failed = failed || !result.passed;
+        }
+      }
+    }
+  }
+  return failed ? 2 : 0;
+}
@@ -0,0 +1,398 @@
+#pragma once
+
+#include "compact_storage.h"
+#include "due_scan.h"
+#include "pending_queue.h"
+#include "time_point_task.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// BlockQueue: bucketed, SIMD-scanned Pending-Queue built for bulk extraction.
+//
+// Taking due Tasks out of a std::set (or the CompactQueue heap) one at a time means one
+// compare-and-branch plus one re-balancing step per Task. At burst sizes that per-Task work is
+// what the workers spend their time on. BlockQueue instead lays the pending Tasks out as:
+//
+//  - buckets_: one Bucket per 2^BucketShift Ticks of deadline, in deadline order.
+//  - Block:    64 unsorted lanes of (32-bit Tick, 32-bit payload id), struct-of-arrays and
+//              cache-line aligned, so a whole Block is compared against now with a handful of
+//              AVX2/SSE4.1 instructions (see due_scan.h).
+//
+// pop_until(now) then works a Bucket at a time: a Bucket whose whole Tick range is <= now is
+// handed out without comparing a single deadline, and only the one Bucket that straddles now
+// is scanned with the vectorized DueMask. Insert is an append to the last Block of the Bucket.
+// Within a batch the Tasks are not in deadline order, they are all due.
+//
+// Deadlines and payloads use the same TickWindow/TaskSlab as the CompactQueue, so a pending
+// Task costs 8 bytes of Block plus its callable. Like there, deadlines before the epoch of the
+// window wait in past_ by their time_point, and come out first, in order.
+//
+// Like SetQueue the BlockQueue is not thread-safe; it is an OrderedPendingQueue guarded by
+// the Wait policy.
+//
+template <typename Tick = std::chrono::milliseconds, unsigned BucketShift = 4>
+class BlockQueue
+{
+public:
+  using tick_t = Tick;
+
+  void insert(TimePointTask &&task)
+  {
+    insert(task.GetRunTimePoint(), task.ReleaseTask());
+  }
+
+  void insert(const Task::time_point_t &time_to_run, Task::task_t &&function)
+  {
+    const int64_t ticks = window_.to_ticks(time_to_run);
+    if (window_.before_epoch(time_to_run))
+    {
+      past_.emplace(time_to_run, std::move(function));
+    }
+    else if (ticks >= kNever)
+    {
+      overflow_.emplace(time_to_run, std::move(function));
+    }
+    else
+    {
+      add(static_cast<uint32_t>(ticks), payloads_.allocate(std::move(function)));
+    }
+    ++size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  //
+  // @brief: time_point of the earliest Task (rounded up to its Tick). The queue must not be empty.
+  //
+  Task::time_point_t earliest() const
+  {
+    if (!past_.empty())
+    {
+      return past_.begin()->first;
+    }
+    if (buckets_.empty())
+    {
+      return overflow_.begin()->first;
+    }
+    return window_.to_time_point(min_tick(buckets_.begin()->second));
+  }
+
+  //
+  // @brief: Remove and return the earliest Task. The queue must not be empty.
+  //
+  TimePointTask pop_front()
+  {
+    std::vector<TimePointTask> task;
+    if (pop_until(earliest(), task, 1) == 0)
+    {
+      throw std::logic_error("BlockQueue: pop_front on an empty queue");
+    }
+    return std::move(task.front());
+  }
+
+  //
+  // @brief: Move up to max_count Tasks that are due at now into out, in one pass.
+  // @return: number of Tasks appended to out
+  //
+  template <typename Container>
+  size_t pop_until(const Task::time_point_t &now, Container &out, size_t max_count)
+  {
+    maybe_rebase(now);
+
+    size_t popped = 0;
+    while (popped < max_count && !past_.empty() && past_.begin()->first <= now)
+    {
+      auto node = past_.extract(past_.begin());
+      out.emplace_back(node.key(), std::move(node.mapped()));
+      ++popped;
+    }
+
+    const int64_t elapsed = window_.elapsed_ticks(now);
+    if (elapsed < 0)
+    {
+      size_ -= popped;
+      return popped;
+    }
+    const uint32_t now_tick = static_cast<uint32_t>(std::min<int64_t>(elapsed, kNever - 1));
+    while (popped < max_count && !buckets_.empty())
+    {
+      auto bucket = buckets_.begin();
+      if (min_tick(bucket->second) > now_tick)
+      {
+        break;
+      }
+
+      const uint64_t last_tick = ((static_cast<uint64_t>(bucket->first) + 1) << BucketShift) - 1;
+      if (last_tick <= now_tick)
+      {
+        popped += take_all(bucket->second, out, max_count - popped);
+      }
+      else
+      {
+        popped += take_due(bucket->second, now_tick, out, max_count - popped);
+      }
+
+      if (bucket->second.blocks.empty())
+      {
+        buckets_.erase(bucket);
+      }
+    }
+
+    while (popped < max_count && buckets_.empty() && !overflow_.empty() && overflow_.begin()->first <= now)
+    {
+      auto node = overflow_.extract(overflow_.begin());
+      out.emplace_back(node.key(), std::move(node.mapped()));
+      ++popped;
+    }
+
+    size_ -= popped;
+    return popped;
+  }
+
+  void clear()
+  {
+    buckets_.clear();
+    payloads_.clear();
+    overflow_.clear();
+    past_.clear();
+    size_ = 0;
+  }
+
+private:
+  using window_t = TickWindow<Tick>;
+
+  // Tick of the unused lanes of a Block. Deadlines from here on wait in overflow_.
+  static constexpr uint32_t kNever = std::numeric_limits<uint32_t>::max();
+
+  struct alignas(64) Block
+  {
+    uint32_t ticks[kDueScanLanes]; // Deadline of each lane, kNever when unused
+    uint32_t ids[kDueScanLanes]; // Payload id of each lane
+    uint32_t size{0}; // Used lanes, always [0, size)
+    uint32_t prefix_min{kNever}; // Earliest deadline of this Block and of the Blocks before it
+
+    Block()
+    {
+      std::fill(std::begin(ticks), std::end(ticks), kNever);
+    }
+  };
+
+  //
+  // Block::prefix_min is the running minimum over the Blocks up to it, so the last one gives
+  // the earliest deadline of the Bucket in O(1). Whoever removes lanes recomputes it from the
+  // first Block that changed on: take_all only shrinks the last Block, but take_due takes
+  // lanes out of any Block it scans and moves the last Block into the place of one it
+  // empties, so it recomputes from the first Block it touched (first_changed).
+  //
+  // add only appends to the last Block, so a Block that take_due drained in part is never
+  // refilled: a Bucket that straddles now for a while may hold mostly empty Blocks (576
+  // bytes each) until take_all drains it once the whole Bucket is due.
+  //
+  struct Bucket
+  {
+    std::vector<Block> blocks; // Only the last Block takes new lanes
+  };
+
+  static uint32_t min_tick(const Bucket &bucket)
+  {
+    return bucket.blocks.empty() ? kNever : bucket.blocks.back().prefix_min;
+  }
+
+  //
+  // @brief: Recompute prefix_min of the Blocks of bucket from index first on.
+  //
+  static void update_min(Bucket &bucket, size_t first)
+  {
+    for (size_t b = first; b < bucket.blocks.size(); ++b)
+    {
+      const uint32_t before = b == 0 ? kNever : bucket.blocks[b - 1].prefix_min;
+      bucket.blocks[b].prefix_min = std::min(before, MinTick(bucket.blocks[b].ticks));
+    }
+  }
+
+  void add(uint32_t ticks, uint32_t id)
+  {
+    Bucket &bucket = buckets_[ticks >> BucketShift];
+    if (bucket.blocks.empty() || bucket.blocks.back().size == kDueScanLanes)
+    {
+      const uint32_t before = min_tick(bucket);
+      bucket.blocks.emplace_back();
+      bucket.blocks.back().prefix_min = before;
+    }
+    Block &block = bucket.blocks.back();
+    block.ticks[block.size] = ticks;
+    block.ids[block.size] = id;
+    ++block.size;
+    block.prefix_min = std::min(block.prefix_min, ticks);
+  }
+
+  template <typename Container>
+  void emit(uint32_t ticks, uint32_t id, Container &out)
+  {
+    out.emplace_back(window_.to_time_point(ticks), payloads_.release(id));
+  }
+
+  //
+  // @brief: The whole Bucket is due: hand lanes out from the back without any compare.
+  //    Only the last Block left may have lost lanes, so only its prefix_min is refreshed.
+  //
+  template <typename Container>
+  size_t take_all(Bucket &bucket, Container &out, size_t max_count)
+  {
+    size_t taken = 0;
+    while (taken < max_count && !bucket.blocks.empty())
+    {
+      Block &block = bucket.blocks.back();
+      while (taken < max_count && block.size > 0)
+      {
+        --block.size;
+        emit(block.ticks[block.size], block.ids[block.size], out);
+        block.ticks[block.size] = kNever;
+        ++taken;
+      }
+      if (block.size == 0)
+      {
+        bucket.blocks.pop_back();
+      }
+    }
+    if (!bucket.blocks.empty())
+    {
+      update_min(bucket, bucket.blocks.size() - 1);
+    }
+    return taken;
+  }
+
+  //
+  // @brief: The Bucket straddles now: find the due lanes of every Block with one vectorized
+  //    compare, hand them out and close the gaps. The Blocks are visited from the last one,
+  //    so that a burst of same-Tick lanes empties Blocks at the back, and prefix_min is only
+  //    recomputed over the Blocks that were visited anyway.
+  //
+  template <typename Container>
+  size_t take_due(Bucket &bucket, uint32_t now_tick, Container &out, size_t max_count)
+  {
+    size_t taken = 0;
+    size_t first_changed = bucket.blocks.size();
+    for (size_t b = bucket.blocks.size(); b > 0 && taken < max_count;)
+    {
+      --b;
+      Block &block = bucket.blocks[b];
+      uint64_t mask = DueMask(block.ticks, now_tick);
+      if (mask == 0)
+      {
+        continue;
+      }
+      first_changed = b;
+
+      uint64_t taken_mask = 0;
+      for (; mask != 0 && taken < max_count; mask &= mask - 1, ++taken)
+      {
+        const unsigned lane = static_cast<unsigned>(__builtin_ctzll(mask));
+        emit(block.ticks[lane], block.ids[lane], out);
+        taken_mask |= uint64_t{1} << lane;
+      }
+
+      uint32_t kept = 0;
+      for (uint32_t lane = 0; lane < block.size; ++lane)
+      {
+        if (!(taken_mask >> lane & 1))
+        {
+          block.ticks[kept] = block.ticks[lane];
+          block.ids[kept] = block.ids[lane];
+          ++kept;
+        }
+      }
+      std::fill(block.ticks + kept, block.ticks + block.size, kNever);
+      block.size = kept;
+
+      if (block.size == 0)
+      {
+        // The Blocks behind b were visited already: moving the last one here is fine.
+        std::swap(block, bucket.blocks.back());
+        bucket.blocks.pop_back();
+      }
+    }
+    update_min(bucket, first_changed);
+    return taken;
+  }
+
+  //
+  // @brief: Re-base the TickWindow once half of it has elapsed. The shift is a whole number of
+  //    Buckets, so every Bucket keeps its lanes, except the Buckets that fall before the new
+  //    epoch: their lanes move to past_ with their time_point.
+  //
+  void maybe_rebase(const Task::time_point_t &now)
+  {
+    if (!window_.needs_rebase(now))
+    {
+      return;
+    }
+
+    const window_t old_window = window_;
+    const uint32_t shift = window_.rebase(now, uint32_t{1} << BucketShift);
+    std::map<uint32_t, Bucket> buckets;
+    for (auto &[index, bucket] : buckets_)
+    {
+      if (index < (shift >> BucketShift))
+      {
+        for (const Block &block : bucket.blocks)
+        {
+          for (uint32_t lane = 0; lane < block.size; ++lane)
+          {
+            past_.emplace(old_window.to_time_point(block.ticks[lane]), payloads_.release(block.ids[lane]));
+          }
+        }
+        continue;
+      }
+      Bucket &target = buckets[index - (shift >> BucketShift)];
+      for (Block &block : bucket.blocks)
+      {
+        for (uint32_t lane = 0; lane < block.size; ++lane)
+        {
+          block.ticks[lane] -= shift;
+        }
+        target.blocks.push_back(std::move(block));
+        update_min(target, target.blocks.size() - 1);
+      }
+    }
+    buckets_ = std::move(buckets);
+
+    while (!overflow_.empty() && window_.to_ticks(overflow_.begin()->first) < kNever)
+    {
+      auto node = overflow_.extract(overflow_.begin());
+      add(static_cast<uint32_t>(window_.to_ticks(node.key())), payloads_.allocate(std::move(node.mapped())));
+    }
+  }
+
+  window_t window_; // Tick 0 of the Blocks
+  std::map<uint32_t, Bucket> buckets_; // Bucket index (Tick >> BucketShift) to its Blocks
+  TaskSlab payloads_; // Callables, indexed by id
+  std::multimap<Task::time_point_t, Task::task_t> overflow_; // Deadlines beyond the 32-bit window
+  std::multimap<Task::time_point_t, Task::task_t> past_; // Deadlines before the epoch of the window
+  size_t size_{0}; // Pending Tasks, overflow_ and past_ included
+};
+
+static_assert(OrderedPendingQueue<BlockQueue<>>);
+static_assert(BatchPendingQueue<BlockQueue<>>);
+} // namespace job_manager
+} // namespace vm
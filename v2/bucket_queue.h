@@ -0,0 +1,150 @@
+#pragma once
+
+#include "pending_queue.h"
+#include "time_point_task.h"
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// BucketQueue: one node per distinct deadline, with a FIFO batch of Tasks inside each node.
+//
+// Producers that quantize their deadlines (ex. to the next 10ms boundary) queue thousands of
+// Tasks with the very same time_point. The std::set stored (and re-balanced) one node per Task,
+// and the ThreadSafeOrderedList one locked Node per Task. BucketQueue coalesces them instead:
+//
+//  - buckets_: ordered map from a deadline to its Bucket, one node per *distinct* deadline.
+//  - index_:   hash index from a deadline to its Bucket, so a Task whose deadline already has a
+//              Bucket is appended in O(1) without walking the ordered map.
+//
+// Inside a Bucket the Tasks only keep their function object (they all share the deadline) and
+// are handed out in the order they were queued. pop_until hands a due Bucket out as a whole
+// when it fits in max_count, and in FIFO slices otherwise.
+//
+// Like SetQueue the BucketQueue is not thread-safe; it is an OrderedPendingQueue guarded by
+// the Wait policy.
+//
+class BucketQueue
+{
+public:
+  void insert(TimePointTask &&task)
+  {
+    insert(task.GetRunTimePoint(), task.ReleaseTask());
+  }
+
+  void insert(const Task::time_point_t &time_to_run, Task::task_t &&function)
+  {
+    auto indexed = index_.find(time_to_run.time_since_epoch().count());
+    if (indexed == index_.end())
+    {
+      auto bucket = buckets_.try_emplace(time_to_run).first;
+      indexed = index_.emplace(time_to_run.time_since_epoch().count(), bucket).first;
+    }
+    indexed->second->second.tasks.push_back(std::move(function));
+    ++size_;
+  }
+
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  //
+  // @brief: Number of distinct deadlines, i.e. nodes of the ordered structure.
+  //
+  size_t bucket_count() const
+  {
+    return buckets_.size();
+  }
+
+  //
+  // @brief: time_point of the earliest Bucket. The queue must not be empty.
+  //
+  Task::time_point_t earliest() const
+  {
+    return buckets_.begin()->first;
+  }
+
+  //
+  // @brief: Remove and return the first Task of the earliest Bucket. The queue must not be empty.
+  //
+  TimePointTask pop_front()
+  {
+    auto bucket = buckets_.begin();
+    TimePointTask task(bucket->first, std::move(bucket->second.tasks[bucket->second.head++]));
+    --size_;
+    if (bucket->second.head == bucket->second.tasks.size())
+    {
+      erase(bucket);
+    }
+    return task;
+  }
+
+  //
+  // @brief: Move up to max_count Tasks that are due at now into out, whole Buckets first.
+  // @return: number of Tasks appended to out
+  //
+  template <typename Container>
+  size_t pop_until(const Task::time_point_t &now, Container &out, size_t max_count)
+  {
+    size_t count = 0;
+    while (count < max_count && !buckets_.empty() && buckets_.begin()->first <= now)
+    {
+      auto bucket = buckets_.begin();
+      Bucket &tasks = bucket->second;
+      while (count < max_count && tasks.head < tasks.tasks.size())
+      {
+        out.emplace_back(bucket->first, std::move(tasks.tasks[tasks.head++]));
+        ++count;
+      }
+      if (tasks.head == tasks.tasks.size())
+      {
+        erase(bucket);
+      }
+    }
+    size_ -= count;
+    return count;
+  }
+
+  void clear()
+  {
+    index_.clear();
+    buckets_.clear();
+    size_ = 0;
+  }
+
+private:
+  struct Bucket
+  {
+    std::vector<Task::task_t> tasks; // Function objects in the order they were queued
+    size_t head{0}; // First Task not handed out yet
+  };
+
+  using bucket_map_t = std::map<Task::time_point_t, Bucket>;
+
+  void erase(bucket_map_t::iterator bucket)
+  {
+    index_.erase(bucket->first.time_since_epoch().count());
+    buckets_.erase(bucket);
+  }
+
+  bucket_map_t buckets_; // One node per distinct deadline, in deadline order
+  std::unordered_map<Task::clock_t::rep, bucket_map_t::iterator> index_; // Deadline to its Bucket
+  size_t size_{0}; // Pending Tasks over all Buckets
+};
+
+static_assert(OrderedPendingQueue<BucketQueue>);
+static_assert(BatchPendingQueue<BucketQueue>);
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,180 @@
+#include "clock.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Shared state of the virtual timeline. now is written under mutex but read without it.
+//
+struct VirtualClock::State
+{
+  std::mutex mutex; // Guards everything but the reads of now
+  std::atomic<Task::clock_t::rep> now{Task::clock_t::now().time_since_epoch().count()};
+  size_t participants{0}; // Threads taking part in the schedule
+  std::vector<Sleeper *> sleepers; // Participants blocked in the clock, i.e. idle
+  std::mutex sleep_mutex; // Shared by sleep_until callers, outlives every one of them
+  std::condition_variable sleep_cv;
+};
+
+// Function-local so that the timeline exists before any static TaskPool uses it
+VirtualClock::State &VirtualClock::state()
+{
+  static State state;
+  return state;
+}
+
+Task::time_point_t VirtualClock::now()
+{
+  return Task::time_point_t(Task::clock_t::duration(state().now.load(std::memory_order_acquire)));
+}
+
+void VirtualClock::wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                              const Task::time_point_t &time_point)
+{
+  Sleeper self{time_point, {&cv, lock.mutex()}};
+  block(self, lock);
+}
+
+void VirtualClock::wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock)
+{
+  Sleeper self{Task::time_point_t::max(), {&cv, lock.mutex()}};
+  block(self, lock);
+}
+
+void VirtualClock::sleep_until(const Task::time_point_t &time_point)
+{
+  // A jump signals the sleeper after releasing the clock mutex, possibly once the sleeper has
+  // already returned, so the condition_variable cannot live on the sleeper's stack.
+  State &clock = state();
+  std::unique_lock<std::mutex> lock(clock.sleep_mutex);
+  while (now() < time_point)
+  {
+    wait_until(clock.sleep_cv, lock, time_point);
+  }
+}
+
+void VirtualClock::add_participants(size_t count)
+{
+  State &clock = state();
+  std::lock_guard<std::mutex> clock_lock(clock.mutex);
+  clock.participants += count;
+}
+
+void VirtualClock::remove_participant()
+{
+  State &clock = state();
+  std::vector<Wake> wakes;
+  {
+    std::lock_guard<std::mutex> clock_lock(clock.mutex);
+    --clock.participants;
+    maybe_advance_locked(clock, wakes);
+  }
+  notify(wakes);
+}
+
+void VirtualClock::advance_to(const Task::time_point_t &time_point)
+{
+  State &clock = state();
+  std::vector<Wake> wakes;
+  {
+    std::lock_guard<std::mutex> clock_lock(clock.mutex);
+    advance_locked(clock, time_point, wakes);
+  }
+  notify(wakes);
+}
+
+//
+// Register self as idle and block on its condition_variable.
+//    If self is the last participant to go idle, the clock is advanced right here instead and
+//    the call returns without blocking, after the caller's lock was dropped to wake the others
+//    up: the participants woken by the jump may be waiting on that very lock.
+//
+void VirtualClock::block(Sleeper &self, std::unique_lock<std::mutex> &lock)
+{
+  State &clock = state();
+  std::vector<Wake> wakes;
+  {
+    std::lock_guard<std::mutex> clock_lock(clock.mutex);
+    if (self.deadline <= now())
+    {
+      return;
+    }
+    clock.sleepers.push_back(&self);
+    maybe_advance_locked(clock, wakes);
+    if (!wakes.empty() && !self.woken)
+    {
+      clock.sleepers.erase(std::find(clock.sleepers.begin(), clock.sleepers.end(), &self));
+    }
+  }
+
+  if (!wakes.empty())
+  {
+    lock.unlock();
+    notify(wakes);
+    lock.lock();
+    return;
+  }
+
+  // The caller's lock is held from the registration until cv releases it, and a jump only
+  // signals cv with that lock held, so the wake-up cannot get lost in between.
+  self.wake.cv->wait(lock);
+
+  std::lock_guard<std::mutex> clock_lock(clock.mutex);
+  if (!self.woken)
+  {
+    // Woken by someone else (ex. a producer): busy again.
+    clock.sleepers.erase(std::find(clock.sleepers.begin(), clock.sleepers.end(), &self));
+  }
+}
+
+void VirtualClock::advance_locked(State &clock, Task::time_point_t time_point, std::vector<Wake> &wakes)
+{
+  if (time_point > now())
+  {
+    clock.now.store(time_point.time_since_epoch().count(), std::memory_order_release);
+  }
+  const Task::time_point_t current = now();
+  auto due = std::partition(clock.sleepers.begin(), clock.sleepers.end(),
+                            [&](const Sleeper *sleeper) { return sleeper->deadline > current; });
+  for (auto it = due; it != clock.sleepers.end(); ++it)
+  {
+    (*it)->woken = true;
+    wakes.push_back((*it)->wake);
+  }
+  clock.sleepers.erase(due, clock.sleepers.end());
+}
+
+//
+// Jump to the earliest deadline once every participant is idle.
+//
+void VirtualClock::maybe_advance_locked(State &clock, std::vector<Wake> &wakes)
+{
+  if (clock.participants == 0 || clock.sleepers.size() < clock.participants)
+  {
+    return;
+  }
+  Task::time_point_t next = Task::time_point_t::max();
+  for (const Sleeper *sleeper : clock.sleepers)
+  {
+    next = std::min(next, sleeper->deadline);
+  }
+  if (next != Task::time_point_t::max())
+  {
+    advance_locked(clock, next, wakes);
+  }
+}
+
+void VirtualClock::notify(const std::vector<Wake> &wakes)
+{
+  for (const Wake &wake : wakes)
+  {
+    std::lock_guard<std::mutex> lock(*wake.mutex);
+    wake.cv->notify_all();
+  }
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Clock policies of the TaskPool.
+//
+// The Wait and Executor policies never call std::chrono::steady_clock directly; they read the
+// time and block through a Clock policy. Every Clock uses Task::time_point_t (a steady_clock
+// time_point) as its time_point, so the Pending-Queues, TimePointTask and QueueJob keep their
+// types and only the source of "now" and the way of waiting change.
+//
+// Threads that take part in the schedule (the workers, the fire-and-forget threads, and any
+// driver thread that wants simulated time to wait for it) are counted as participants. The
+// real clock ignores that; the VirtualClock uses it to know when every participant is idle.
+//
+
+//
+// @brief: Requirements on a Clock policy
+//    now:            current time
+//    wait_until:     cv.wait_until(lock, time_point); may return early (callers re-check)
+//    wait:           cv.wait(lock); may return early
+//    sleep_until:    block the calling participant until time_point
+//    add_participants / remove_participant: book-keeping of the participating threads
+//
+template <typename C>
+concept Clock = requires(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                         const Task::time_point_t &time_point, size_t count) {
+  { C::now() } -> std::same_as<Task::time_point_t>;
+  C::wait_until(cv, lock, time_point);
+  C::wait(cv, lock);
+  C::sleep_until(time_point);
+  C::add_participants(count);
+  C::remove_participant();
+};
+
+//
+// SteadyClock: real time, std::chrono::steady_clock.
+//
+struct SteadyClock
+{
+  static Task::time_point_t now()
+  {
+    return Task::clock_t::now();
+  }
+
+  static void wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                         const Task::time_point_t &time_point)
+  {
+    cv.wait_until(lock, time_point);
+  }
+
+  static void wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock)
+  {
+    cv.wait(lock);
+  }
+
+  static void sleep_until(const Task::time_point_t &time_point)
+  {
+    std::this_thread::sleep_until(time_point);
+  }
+
+  static void add_participants(size_t) {}
+  static void remove_participant() {}
+};
+
+//
+// VirtualClock: simulated time for deterministic, faster-than-real-time schedule replay.
+//
+// Time stands still while any participant is busy. As soon as the last participant blocks in
+// wait/wait_until/sleep_until, the clock jumps straight to the earliest time_point any of them
+// is waiting for and wakes up every participant that is due at the new time. A day of
+// scheduled traffic therefore runs in the CPU time it takes to dispatch it, with no sleeping.
+//
+// There is a single virtual timeline per process; it starts at the real steady_clock time of
+// the first call. A thread that queues Jobs while the workers are idle (a simulation driver)
+// must be a participant for the whole run (see Participant), or the clock may move on before
+// it has queued everything that is due earlier.
+//
+// The waits may return early (after a jump, or when another thread notifies the same
+// condition_variable); callers always re-check their condition, as with spurious wake-ups.
+//
+class VirtualClock
+{
+public:
+  //
+  // RAII registration of the calling thread as a participant.
+  //
+  class Participant
+  {
+  public:
+    Participant() { add_participants(1); }
+    ~Participant() { remove_participant(); }
+    Participant(const Participant &) = delete;
+    Participant &operator=(const Participant &) = delete;
+  };
+
+  static Task::time_point_t now();
+
+  static void wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                         const Task::time_point_t &time_point);
+
+  static void wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock);
+
+  static void sleep_until(const Task::time_point_t &time_point);
+
+  static void add_participants(size_t count);
+
+  static void remove_participant();
+
+  //
+  // @brief: Move the clock forward to time_point (never backwards), waking whoever is due.
+  //
+  static void advance_to(const Task::time_point_t &time_point);
+
+private:
+  struct Wake
+  {
+    std::condition_variable *cv; // Signaled to wake the participant
+    std::mutex *mutex; // Held by the participant until it blocks on cv
+  };
+
+  struct Sleeper
+  {
+    Task::time_point_t deadline; // time_point the participant waits for, max() if none
+    Wake wake;
+    bool woken{false}; // Set (under the clock mutex) once the clock woke it
+  };
+
+  struct State;
+
+  static State &state();
+  static void block(Sleeper &self, std::unique_lock<std::mutex> &lock);
+  static void advance_locked(State &state, Task::time_point_t time_point, std::vector<Wake> &wakes);
+  static void maybe_advance_locked(State &state, std::vector<Wake> &wakes);
+  static void notify(const std::vector<Wake> &wakes);
+};
+
+static_assert(Clock<SteadyClock>);
+static_assert(Clock<VirtualClock>);
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "compact_storage.h"
+#include "pending_queue.h"
+#include "time_point_task.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// CompactQueue: struct-of-arrays Pending-Queue for very large numbers of pending Tasks.
+//
+// The std::set and the ThreadSafeOrderedList pay for a whole TimePointTask plus a tree/list
+// Node (with its pointers, and for Version-1 a std::mutex and a separate allocation of the
+// data) per pending Task. CompactQueue splits a Task in two:
+//  - keys_:     a 4-ary min-heap of 64-bit keys. The high 32 bits are the deadline, in Ticks
+//               of window_, the low 32 bits are the id of the payload. Ordering, sifting and
+//               re-basing only ever touch this contiguous array.
+//  - payloads_: a TaskSlab of callables indexed by the 32-bit id.
+//
+// The cost of a pending Task is 8 bytes of key plus its callable (plus 4 bytes while its slot
+// sits on the free list), instead of the ~100+ bytes of the node based queues. The callable
+// is a 32-byte std::function, and more on the heap when its captures do not fit its small
+// buffer, so a pending Task takes 40 bytes at the very least: 50M pending timers take ~2 GB,
+// not a few hundred MB. Getting below that would take a payload other than std::function.
+//
+// Deadlines are Ticks of a TickWindow (compact_storage.h). The window is re-based onto the
+// time a worker pops at (the clock of the Pool) once half of it has elapsed, and the rare
+// deadline that is further away than the window waits in overflow_ until it fits. Deadlines
+// before the epoch of the window (queued in the past) wait in past_, by their time_point,
+// and come out first, in order.
+//
+// Like SetQueue the CompactQueue is not thread-safe; it is an OrderedPendingQueue guarded by
+// the Wait policy.
+//
+template <typename Tick = std::chrono::milliseconds>
+class CompactQueue
+{
+public:
+  using tick_t = Tick;
+
+  //
+  // @brief: Reserve room for num_tasks pending Tasks up front, so filling the queue does not
+  //    go through repeated reallocation of the key heap and the payload slab.
+  //
+  void reserve(size_t num_tasks)
+  {
+    keys_.reserve(num_tasks);
+    payloads_.reserve(num_tasks);
+  }
+
+  void insert(TimePointTask &&task)
+  {
+    insert(task.GetRunTimePoint(), task.ReleaseTask());
+  }
+
+  void insert(const Task::time_point_t &time_to_run, Task::task_t &&function)
+  {
+    if (window_.before_epoch(time_to_run))
+    {
+      past_.emplace(time_to_run, std::move(function));
+      return;
+    }
+    const int64_t ticks = window_.to_ticks(time_to_run);
+    if (ticks > window_t::kMaxTick)
+    {
+      overflow_.emplace(time_to_run, std::move(function));
+      return;
+    }
+
+    const uint32_t id = payloads_.allocate(std::move(function));
+    keys_.push_back(make_key(static_cast<uint32_t>(ticks), id));
+    sift_up(keys_.size() - 1);
+  }
+
+  bool empty() const
+  {
+    return keys_.empty() && overflow_.empty() && past_.empty();
+  }
+
+  size_t size() const
+  {
+    return keys_.size() + overflow_.size() + past_.size();
+  }
+
+  //
+  // @brief: time_point of the earliest Task (rounded up to its Tick). The queue must not be empty.
+  //
+  Task::time_point_t earliest() const
+  {
+    if (!past_.empty())
+    {
+      return past_.begin()->first;
+    }
+    if (keys_.empty())
+    {
+      return overflow_.begin()->first;
+    }
+    return window_.to_time_point(key_ticks(keys_.front()));
+  }
+
+  //
+  // @brief: Remove and return the earliest Task. The queue must not be empty.
+  //
+  TimePointTask pop_front()
+  {
+    if (!past_.empty())
+    {
+      auto node = past_.extract(past_.begin());
+      return TimePointTask(node.key(), std::move(node.mapped()));
+    }
+    if (keys_.empty())
+    {
+      auto node = overflow_.extract(overflow_.begin());
+      return TimePointTask(node.key(), std::move(node.mapped()));
+    }
+
+    const uint64_t key = keys_.front();
+    keys_.front() = keys_.back();
+    keys_.pop_back();
+    if (!keys_.empty())
+    {
+      sift_down(0);
+    }
+
+    return TimePointTask(window_.to_time_point(key_ticks(key)), payloads_.release(key_id(key)));
+  }
+
+  //
+  // @brief: Move up to max_count Tasks that are due at now into out.
+  //    now comes from the clock of the Pool, and is also what the window is re-based onto.
+  // @return: number of Tasks appended to out
+  //
+  template <typename Container>
+  size_t pop_until(const Task::time_point_t &now, Container &out, size_t max_count)
+  {
+    maybe_rebase(now);
+
+    size_t count = 0;
+    while (count < max_count && !empty() && earliest() <= now)
+    {
+      out.push_back(pop_front());
+      ++count;
+    }
+    return count;
+  }
+
+  void clear()
+  {
+    keys_.clear();
+    payloads_.clear();
+    overflow_.clear();
+    past_.clear();
+  }
+
+private:
+  using window_t = TickWindow<Tick>;
+
+  static uint64_t make_key(uint32_t ticks, uint32_t id)
+  {
+    return (static_cast<uint64_t>(ticks) << 32) | id;
+  }
+
+  static uint32_t key_ticks(uint64_t key)
+  {
+    return static_cast<uint32_t>(key >> 32);
+  }
+
+  static uint32_t key_id(uint64_t key)
+  {
+    return static_cast<uint32_t>(key);
+  }
+
+  //
+  // @brief: Re-base the TickWindow once half of it has elapsed.
+  //    Every key is shifted down by the same amount, and the keys that fall before the new
+  //    epoch move to past_ with their time_point, so the heap is rebuilt afterwards; it is a
+  //    linear pass over keys_ that happens once per half window (~24 days with millisecond
+  //    Ticks).
+  //
+  void maybe_rebase(const Task::time_point_t &now)
+  {
+    if (!window_.needs_rebase(now))
+    {
+      return;
+    }
+
+    const window_t old_window = window_;
+    const uint32_t shift = window_.rebase(now);
+    size_t kept = 0;
+    for (const uint64_t key : keys_)
+    {
+      const uint32_t ticks = key_ticks(key);
+      if (ticks < shift)
+      {
+        past_.emplace(old_window.to_time_point(ticks), payloads_.release(key_id(key)));
+        continue;
+      }
+      keys_[kept++] = make_key(ticks - shift, key_id(key));
+    }
+    keys_.resize(kept);
+    for (size_t i = keys_.size() / kArity + 1; i-- > 0;)
+    {
+      if (i < keys_.size())
+      {
+        sift_down(i);
+      }
+    }
+
+    while (!overflow_.empty() && window_.to_ticks(overflow_.begin()->first) <= window_t::kMaxTick)
+    {
+      auto node = overflow_.extract(overflow_.begin());
+      const uint32_t id = payloads_.allocate(std::move(node.mapped()));
+      keys_.push_back(make_key(static_cast<uint32_t>(window_.to_ticks(node.key())), id));
+      sift_up(keys_.size() - 1);
+    }
+  }
+
+  // A 4-ary heap is shallower than a binary one and its children share a cache line.
+  static constexpr size_t kArity = 4;
+
+  void sift_up(size_t index)
+  {
+    const uint64_t key = keys_[index];
+    while (index > 0)
+    {
+      const size_t parent = (index - 1) / kArity;
+      if (keys_[parent] <= key)
+      {
+        break;
+      }
+      keys_[index] = keys_[parent];
+      index = parent;
+    }
+    keys_[index] = key;
+  }
+
+  void sift_down(size_t index)
+  {
+    const uint64_t key = keys_[index];
+    const size_t size = keys_.size();
+    while (true)
+    {
+      const size_t first_child = index * kArity + 1;
+      if (first_child >= size)
+      {
+        break;
+      }
+      const size_t last_child = std::min(first_child + kArity, size);
+      size_t smallest = first_child;
+      for (size_t child = first_child + 1; child < last_child; ++child)
+      {
+        if (keys_[child] < keys_[smallest])
+        {
+          smallest = child;
+        }
+      }
+      if (key <= keys_[smallest])
+      {
+        break;
+      }
+      keys_[index] = keys_[smallest];
+      index = smallest;
+    }
+    keys_[index] = key;
+  }
+
+  window_t window_; // Tick 0 of the keys
+  std::vector<uint64_t> keys_; // 4-ary min-heap of (ticks << 32 | id)
+  TaskSlab payloads_; // Callables, indexed by id
+  std::multimap<Task::time_point_t, Task::task_t> overflow_; // Deadlines beyond the 32-bit window
+  std::multimap<Task::time_point_t, Task::task_t> past_; // Deadlines before the epoch of the window
+};
+
+static_assert(OrderedPendingQueue<CompactQueue<>>);
+static_assert(BatchPendingQueue<CompactQueue<>>);
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Building blocks shared by the compact Pending-Queues (CompactQueue, BlockQueue).
+//
+
+//
+// TickWindow: maps a time_point to a 32-bit number of Ticks since an epoch.
+//
+// Deadlines are rounded up to the next Tick, so a Task never runs early but may run up to one
+// Tick late. With millisecond Ticks the 32-bit window spans ~49 days. The owner re-bases the
+// window onto the current time (see needs_rebase/rebase) once half of it has elapsed.
+// Deadlines before the epoch have no Tick of their own (see before_epoch): the owner keeps
+// them apart, by their time_point, rather than lose their order at Tick 0.
+//
+template <typename Tick>
+class TickWindow
+{
+public:
+  using tick_t = Tick;
+
+  static constexpr int64_t kMaxTick = std::numeric_limits<uint32_t>::max();
+
+  TickWindow() : epoch_(Task::clock_t::now()) {}
+
+  //
+  // @brief: Ticks from the epoch to time_point, rounded up. Past deadlines clamp to Tick 0.
+  //    The result is greater than kMaxTick for deadlines beyond the window.
+  //
+  int64_t to_ticks(const Task::time_point_t &time_point) const
+  {
+    if (time_point <= epoch_)
+    {
+      return 0;
+    }
+    return std::chrono::ceil<tick_t>(time_point - epoch_).count();
+  }
+
+  //
+  // @brief: True if time_point is before Tick 0.
+  //
+  bool before_epoch(const Task::time_point_t &time_point) const
+  {
+    return time_point < epoch_;
+  }
+
+  //
+  // @brief: Whole Ticks elapsed from the epoch to now, rounded down: every Tick up to and
+  //    including the result is due at now. Negative if now is before the epoch.
+  //
+  int64_t elapsed_ticks(const Task::time_point_t &now) const
+  {
+    if (now < epoch_)
+    {
+      return -1;
+    }
+    return std::chrono::floor<tick_t>(now - epoch_).count();
+  }
+
+  Task::time_point_t to_time_point(uint32_t ticks) const
+  {
+    return epoch_ + tick_t(ticks);
+  }
+
+  //
+  // @brief: True once now is more than half a window past the epoch.
+  //
+  bool needs_rebase(const Task::time_point_t &now) const
+  {
+    return to_ticks(now) >= kMaxTick / 2;
+  }
+
+  //
+  // @brief: Move the epoch forward to (about) now, in multiples of alignment Ticks.
+  //    Returns the number of Ticks every stored key has to be shifted down by.
+  //
+  uint32_t rebase(const Task::time_point_t &now, uint32_t alignment = 1)
+  {
+    int64_t shift = to_ticks(now) - 1;
+    shift -= shift % alignment;
+    epoch_ += tick_t(shift);
+    return static_cast<uint32_t>(shift);
+  }
+
+private:
+  Task::time_point_t epoch_; // Tick 0
+};
+
+//
+// TaskSlab: function objects stored apart from their deadlines, addressed by a 32-bit id.
+// Slots are recycled through a free list, so the slab does not grow past the peak number of
+// pending Tasks.
+//
+class TaskSlab
+{
+public:
+  void reserve(size_t num_tasks)
+  {
+    payloads_.reserve(num_tasks);
+  }
+
+  uint32_t allocate(Task::task_t &&function)
+  {
+    if (!free_ids_.empty())
+    {
+      const uint32_t id = free_ids_.back();
+      free_ids_.pop_back();
+      payloads_[id] = std::move(function);
+      return id;
+    }
+    payloads_.push_back(std::move(function));
+    return static_cast<uint32_t>(payloads_.size() - 1);
+  }
+
+  //
+  // @brief: Move the function object out of slot id and recycle the slot.
+  //
+  Task::task_t release(uint32_t id)
+  {
+    Task::task_t function = std::move(payloads_[id]);
+    payloads_[id] = nullptr;
+    if (id + 1 == payloads_.size())
+    {
+      payloads_.pop_back();
+    }
+    else
+    {
+      free_ids_.push_back(id);
+    }
+    return function;
+  }
+
+  void clear()
+  {
+    payloads_.clear();
+    free_ids_.clear();
+  }
+
+private:
+  std::vector<Task::task_t> payloads_; // Slab of callables, indexed by id
+  std::vector<uint32_t> free_ids_; // Recycled slots of payloads_
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,60 @@
+#include "cost_estimator.h"
+#include "lateness.h"
+
+#include <algorithm>
+
+namespace vm
+{
+namespace job_manager
+{
+const std::type_info &KindOf(const Task::task_t &function)
+{
+  if (const HintedJob *hinted = function.target<HintedJob>())
+  {
+    return *hinted->kind;
+  }
+  if (const KindedJob *kinded = function.target<KindedJob>())
+  {
+    return *kinded->kind;
+  }
+  if (const LateJob *late = function.target<LateJob>())
+  {
+    return *late->kind;
+  }
+  return function.target_type();
+}
+
+size_t CostEstimator::IndexOf(const std::type_info &kind)
+{
+  // type_info objects are at least pointer aligned: drop the low bits, then mix.
+  const uint64_t address = reinterpret_cast<uintptr_t>(&kind) >> 3;
+  return (address * 0x9e3779b97f4a7c15ull) >> 54;
+}
+
+void CostEstimator::Record(const std::type_info &kind, uint64_t duration_ns)
+{
+  static_assert(kKinds == 1024, "IndexOf keeps the top 10 bits of the hash");
+  Entry &entry = entries_[IndexOf(kind)];
+  duration_ns = std::max<uint64_t>(duration_ns, 1);
+  if (entry.kind.load(std::memory_order_relaxed) != &kind)
+  {
+    entry.kind.store(&kind, std::memory_order_relaxed);
+    entry.average_ns.store(duration_ns, std::memory_order_relaxed);
+    return;
+  }
+  const int64_t average = static_cast<int64_t>(entry.average_ns.load(std::memory_order_relaxed));
+  const int64_t updated = average + ((static_cast<int64_t>(duration_ns) - average) >> kWeightShift);
+  entry.average_ns.store(static_cast<uint64_t>(std::max<int64_t>(updated, 1)), std::memory_order_relaxed);
+}
+
+uint64_t CostEstimator::Estimate(const std::type_info &kind) const
+{
+  const Entry &entry = entries_[IndexOf(kind)];
+  if (entry.kind.load(std::memory_order_relaxed) != &kind)
+  {
+    return 0;
+  }
+  return entry.average_ns.load(std::memory_order_relaxed);
+}
+} // namespace job_manager
+} // namespace vm
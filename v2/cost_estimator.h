@@ -0,0 +1,106 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <typeinfo>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Inline execution of tiny Jobs.
+//
+// A flag flip or a counter update takes a few hundred nanoseconds; handing it to an
+// AsyncExecutor thread costs a thread creation and a join, a hundred times more. A Job can
+// be queued with an ExecutionHint:
+//  - kInline: run it on the worker that takes it out of the queue, like an InlineExecutor
+//  - kPooled: always hand it to the Executor
+//  - kAuto:   run it inline if the CostEstimator of the Pool (when enabled) estimates its kind
+//             as cheap, hand it to the Executor otherwise (the default)
+//
+// Inline Jobs hold up the dispatch of the Jobs behind them, so every wake-up of a worker has
+// an inline time budget: once the Jobs it ran inline took that long, the rest of its batch
+// goes to the Executor, whatever their hint.
+//
+enum class ExecutionHint : uint8_t
+{
+  kAuto,
+  kInline,
+  kPooled,
+};
+
+//
+// HintedJob: the callable a Job with an ExecutionHint other than kAuto is queued as. The
+// worker recognizes it (std::function::target) and follows the hint.
+//
+struct HintedJob
+{
+  void operator()() { job(); }
+
+  ExecutionHint hint{ExecutionHint::kAuto};
+  const std::type_info *kind{&typeid(void)}; // KindOf the Job it wraps
+  Task::task_t job;
+};
+
+//
+// KindedJob: the callable of a wrapper that records around the Job it runs (the trace and
+// the timeline). It keeps the kind of that Job, like HintedJob and LateJob do.
+//
+struct KindedJob
+{
+  void operator()() { job(); }
+
+  const std::type_info *kind{&typeid(void)}; // KindOf the Job it wraps
+  Task::task_t job;
+};
+
+//
+// @brief: Kind of a Job for the CostEstimator: the type of the callable it was queued with,
+//    seen through the wrappers of the Pool (HintedJob, KindedJob, LateJob), which would
+//    otherwise make every wrapped Job the same kind.
+//
+const std::type_info &KindOf(const Task::task_t &function);
+
+//
+// CostEstimator: exponentially weighted moving average of the duration of every kind of
+// Job, a kind being the type of the callable (every lambda of the code is a type of its own).
+//
+// The averages live in a fixed hash table indexed by the address of the type_info, so
+// estimating costs no allocation and no lock. Updates are plain relaxed stores: two workers
+// recording the same kind at once may lose one sample, and two kinds that hash to the same
+// entry take it over from each other. Both only make the estimate a little staler.
+//
+class CostEstimator
+{
+public:
+  static constexpr size_t kKinds = 1024;
+  static constexpr uint32_t kWeightShift = 3; // Every sample weighs 1/8
+
+  //
+  // @brief: Record that a Job of kind ran for duration_ns.
+  //
+  void Record(const std::type_info &kind, uint64_t duration_ns);
+
+  //
+  // @brief: Average duration of the Jobs of kind, 0 if none was recorded.
+  //
+  uint64_t Estimate(const std::type_info &kind) const;
+
+private:
+  struct Entry
+  {
+    std::atomic<const std::type_info *> kind{nullptr};
+    std::atomic<uint64_t> average_ns{0};
+  };
+
+  static size_t IndexOf(const std::type_info &kind);
+
+  std::array<Entry, kKinds> entries_;
+};
+} // namespace job_manager
+} // namespace vm
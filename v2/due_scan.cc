@@ -0,0 +1,141 @@
+#include "due_scan.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VM_DUE_SCAN_X86 1
+#endif
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+uint64_t DueMaskScalar(const uint32_t *ticks, uint32_t now)
+{
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kDueScanLanes; ++i)
+  {
+    mask |= static_cast<uint64_t>(ticks[i] <= now) << i;
+  }
+  return mask;
+}
+
+uint32_t MinTickScalar(const uint32_t *ticks)
+{
+  return *std::min_element(ticks, ticks + kDueScanLanes);
+}
+
+#ifdef VM_DUE_SCAN_X86
+//
+// There is no unsigned 32-bit compare before AVX-512; max(tick, now) == now is the unsigned
+// tick <= now, and pmaxud is available from SSE4.1 on.
+//
+__attribute__((target("sse4.1")))
+uint64_t DueMaskSse41(const uint32_t *ticks, uint32_t now)
+{
+  const __m128i now_v = _mm_set1_epi32(static_cast<int>(now));
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kDueScanLanes; i += 4)
+  {
+    const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(ticks + i));
+    const __m128i due = _mm_cmpeq_epi32(_mm_max_epu32(v, now_v), now_v);
+    mask |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(due))) << i;
+  }
+  return mask;
+}
+
+__attribute__((target("sse4.1")))
+uint32_t MinTickSse41(const uint32_t *ticks)
+{
+  __m128i min_v = _mm_load_si128(reinterpret_cast<const __m128i *>(ticks));
+  for (size_t i = 4; i < kDueScanLanes; i += 4)
+  {
+    min_v = _mm_min_epu32(min_v, _mm_load_si128(reinterpret_cast<const __m128i *>(ticks + i)));
+  }
+  min_v = _mm_min_epu32(min_v, _mm_shuffle_epi32(min_v, _MM_SHUFFLE(1, 0, 3, 2)));
+  min_v = _mm_min_epu32(min_v, _mm_shuffle_epi32(min_v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(min_v));
+}
+
+__attribute__((target("avx2")))
+uint64_t DueMaskAvx2(const uint32_t *ticks, uint32_t now)
+{
+  const __m256i now_v = _mm256_set1_epi32(static_cast<int>(now));
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kDueScanLanes; i += 8)
+  {
+    const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(ticks + i));
+    const __m256i due = _mm256_cmpeq_epi32(_mm256_max_epu32(v, now_v), now_v);
+    mask |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(due))) << i;
+  }
+  return mask;
+}
+
+__attribute__((target("avx2")))
+uint32_t MinTickAvx2(const uint32_t *ticks)
+{
+  __m256i min_v = _mm256_load_si256(reinterpret_cast<const __m256i *>(ticks));
+  for (size_t i = 8; i < kDueScanLanes; i += 8)
+  {
+    min_v = _mm256_min_epu32(min_v, _mm256_load_si256(reinterpret_cast<const __m256i *>(ticks + i)));
+  }
+  __m128i min_128 = _mm_min_epu32(_mm256_castsi256_si128(min_v), _mm256_extracti128_si256(min_v, 1));
+  min_128 = _mm_min_epu32(min_128, _mm_shuffle_epi32(min_128, _MM_SHUFFLE(1, 0, 3, 2)));
+  min_128 = _mm_min_epu32(min_128, _mm_shuffle_epi32(min_128, _MM_SHUFFLE(2, 3, 0, 1)));
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(min_128));
+}
+#endif
+
+//
+// The implementation picked for this CPU, resolved on first use.
+//
+struct DueScanDispatch
+{
+  uint64_t (*due_mask)(const uint32_t *, uint32_t);
+  uint32_t (*min_tick)(const uint32_t *);
+  const char *name;
+};
+
+DueScanDispatch SelectDueScan()
+{
+#ifdef VM_DUE_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return {&DueMaskAvx2, &MinTickAvx2, "avx2"};
+  }
+  if (__builtin_cpu_supports("sse4.1"))
+  {
+    return {&DueMaskSse41, &MinTickSse41, "sse4.1"};
+  }
+#endif
+  return {&DueMaskScalar, &MinTickScalar, "scalar"};
+}
+
+const DueScanDispatch &DueScan()
+{
+  static const DueScanDispatch dispatch = SelectDueScan();
+  return dispatch;
+}
+} // namespace
+
+uint64_t DueMask(const uint32_t *ticks, uint32_t now)
+{
+  return DueScan().due_mask(ticks, now);
+}
+
+uint32_t MinTick(const uint32_t *ticks)
+{
+  return DueScan().min_tick(ticks);
+}
+
+const char *DueScanImplementation()
+{
+  return DueScan().name;
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Vectorized "which deadlines are due" scan used by the BlockQueue.
+//
+// The deadlines of a block are 32-bit Ticks; a lane is due when its Tick is <= now. Instead of
+// one compare-and-branch per Task, the whole block is compared against now in a few SIMD
+// instructions and the result comes back as a bit mask (bit i set: lane i is due).
+//
+// The implementation is picked once at start-up from what the CPU supports: AVX2 (8 lanes per
+// compare), SSE4.1 (4 lanes) or a portable scalar loop.
+//
+
+// Number of lanes of one block; a multiple of the widest SIMD width.
+inline constexpr size_t kDueScanLanes = 64;
+
+//
+// @brief: Bit mask of the lanes of ticks[0, kDueScanLanes) that are <= now.
+//    ticks must be aligned to 32 bytes. Unused lanes must hold a Tick that is never due
+//    (UINT32_MAX), so the block can be scanned without looking at its size.
+//
+uint64_t DueMask(const uint32_t *ticks, uint32_t now);
+
+//
+// @brief: Smallest of ticks[0, kDueScanLanes), same requirements as DueMask.
+//
+uint32_t MinTick(const uint32_t *ticks);
+
+//
+// @brief: Name of the implementation chosen for this CPU ("avx2", "sse4.1" or "scalar").
+//
+const char *DueScanImplementation();
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Elastic sizing of a TaskPool.
+//
+// A fixed Pool either keeps threads idle on a shared host when the load is low, or runs out of
+// workers when its Jobs block. An elastic Pool starts min_workers and lets a supervisor thread
+// grow it up to max_workers, one worker per interval, while it is overloaded:
+//  - the Jobs taken out of the queue waited more than spawn_wait past their time_point, or
+//  - every worker has been busy handing out (or, with an InlineExecutor, running) Jobs for
+//    spawn_ticks intervals in a row.
+//
+// A worker that has not had a Job for retire_idle leaves again, as long as more than
+// min_workers are left, and no sooner than retire_idle after the last spawn. Spawning reacts
+// within a few intervals and retiring only after seconds: a burst is absorbed at once, and
+// the extra threads go once it has been over for a while, without flapping in between.
+//
+struct ElasticOptions
+{
+  size_t min_workers{4};
+  size_t max_workers{4}; // No supervisor while it is not above min_workers
+  std::chrono::microseconds spawn_wait{2000};
+  size_t spawn_ticks{2};
+  std::chrono::milliseconds retire_idle{5000};
+  std::chrono::milliseconds interval{10}; // Period of the supervisor
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,200 @@
+#include "epoch.h"
+
+#include <array>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+struct Retired
+{
+  void *object;
+  void (*deleter)(void *);
+};
+
+//
+// Record of a thread. The registry of Records only grows; the Record of an exited thread is
+// handed to the next thread that asks for one.
+//
+struct alignas(64) Record
+{
+  std::atomic<uint64_t> state{0}; // Epoch << 1 | 1 while inside a Guard
+  std::atomic<bool> in_use{false};
+  Record *next{nullptr}; // Next Record of the registry
+
+  // Owner thread only.
+  uint32_t depth{0}; // Nested Guards
+  uint32_t retired_since_scan{0};
+  std::array<std::vector<Retired>, 3> limbo; // Retired in limbo_epoch, by epoch % 3
+  std::array<uint64_t, 3> limbo_epoch{};
+};
+
+std::atomic<uint64_t> global_epoch{0};
+std::atomic<Record *> registry{nullptr};
+std::atomic<uint64_t> pending_count{0};
+
+std::mutex orphans_mutex; // Guards orphans
+std::vector<std::pair<uint64_t, Retired>> orphans; // Left behind by exited threads, with their epoch
+
+void Delete(std::vector<Retired> &retired)
+{
+  for (const Retired &object : retired)
+  {
+    object.deleter(object.object);
+  }
+  pending_count.fetch_sub(retired.size(), std::memory_order_relaxed);
+  retired.clear();
+}
+
+Record *Acquire()
+{
+  for (Record *record = registry.load(std::memory_order_acquire); record; record = record->next)
+  {
+    bool used = false;
+    if (!record->in_use.load(std::memory_order_relaxed) && record->in_use.compare_exchange_strong(used, true))
+    {
+      return record;
+    }
+  }
+  Record *record = new Record;
+  record->in_use.store(true, std::memory_order_relaxed);
+  record->next = registry.load(std::memory_order_relaxed);
+  while (!registry.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+  {
+  }
+  return record;
+}
+
+struct Local
+{
+  Record *const record = Acquire();
+
+  ~Local()
+  {
+    {
+      std::lock_guard<std::mutex> lock(orphans_mutex);
+      for (size_t bucket = 0; bucket < record->limbo.size(); ++bucket)
+      {
+        for (const Retired &object : record->limbo[bucket])
+        {
+          orphans.emplace_back(record->limbo_epoch[bucket], object);
+        }
+        record->limbo[bucket].clear();
+      }
+    }
+    record->state.store(0, std::memory_order_relaxed);
+    record->retired_since_scan = 0;
+    record->in_use.store(false, std::memory_order_release);
+  }
+};
+
+Record &Self()
+{
+  thread_local Local local;
+  return *local.record;
+}
+
+//
+// @brief: Move the global epoch on if every thread inside a Guard has seen it, and delete
+//    the orphans that became unreachable.
+//
+void TryAdvance()
+{
+  uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+  for (Record *record = registry.load(std::memory_order_acquire); record; record = record->next)
+  {
+    const uint64_t state = record->state.load(std::memory_order_seq_cst);
+    if ((state & 1) && (state >> 1) != epoch)
+    {
+      return;
+    }
+  }
+  if (global_epoch.compare_exchange_strong(epoch, epoch + 1))
+  {
+    ++epoch;
+  }
+
+  std::vector<Retired> unreachable;
+  {
+    std::lock_guard<std::mutex> lock(orphans_mutex);
+    std::erase_if(orphans, [epoch, &unreachable](const std::pair<uint64_t, Retired> &orphan) {
+      if (orphan.first + 2 > epoch)
+      {
+        return false;
+      }
+      unreachable.push_back(orphan.second);
+      return true;
+    });
+  }
+  Delete(unreachable);
+}
+
+//
+// @brief: Delete the buckets of self that are two epochs old.
+//
+void Collect(Record &self)
+{
+  const uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+  for (size_t bucket = 0; bucket < self.limbo.size(); ++bucket)
+  {
+    if (!self.limbo[bucket].empty() && self.limbo_epoch[bucket] + 2 <= epoch)
+    {
+      Delete(self.limbo[bucket]);
+    }
+  }
+}
+} // namespace
+
+EpochReclaimer::Guard::Guard()
+{
+  Record &self = Self();
+  if (self.depth++ == 0)
+  {
+    self.state.store(global_epoch.load(std::memory_order_relaxed) << 1 | 1, std::memory_order_relaxed);
+    // The announcement must be visible before the first Node is read.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+EpochReclaimer::Guard::~Guard()
+{
+  Record &self = Self();
+  if (--self.depth == 0)
+  {
+    self.state.store(self.state.load(std::memory_order_relaxed) & ~uint64_t{1}, std::memory_order_release);
+  }
+}
+
+void EpochReclaimer::Retire(void *object, void (*deleter)(void *))
+{
+  Record &self = Self();
+  const uint64_t epoch = global_epoch.load(std::memory_order_acquire);
+  const size_t bucket = epoch % self.limbo.size();
+  if (self.limbo_epoch[bucket] != epoch)
+  {
+    // Whatever is left in the bucket was retired three epochs back or more.
+    Delete(self.limbo[bucket]);
+    self.limbo_epoch[bucket] = epoch;
+  }
+  self.limbo[bucket].push_back({object, deleter});
+  pending_count.fetch_add(1, std::memory_order_relaxed);
+
+  if (++self.retired_since_scan >= kScanInterval)
+  {
+    self.retired_since_scan = 0;
+    TryAdvance();
+    Collect(self);
+  }
+}
+
+uint64_t EpochReclaimer::pending()
+{
+  return pending_count.load(std::memory_order_relaxed);
+}
+} // namespace job_manager
+} // namespace vm
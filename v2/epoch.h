@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// EpochReclaimer: epoch-based reclamation of the Nodes of lock-free traversals.
+//
+// A thread that reads shared Nodes without holding their locks does it inside a Guard. A
+// Node unlinked from its structure is not deleted right away but retired: it is deleted
+// once every thread that was inside a Guard when it was retired has left it, so no
+// traversal can still be reading it.
+//
+// There is one global epoch. Every thread announces the epoch it entered its Guard in; the
+// epoch moves on only once every thread inside a Guard has seen the current one, and what
+// was retired two epochs back is then unreachable by everybody. Each thread keeps the Nodes
+// it retired in three buckets, one per epoch that can still be in use, and deletes a bucket
+// when its epoch comes round again. A thread that exits hands its buckets over to the next
+// successful advance.
+//
+// A Guard costs a load and a store of the thread's own record; retiring costs a push_back,
+// plus a scan of the thread records every kScanInterval retirements.
+//
+class EpochReclaimer
+{
+public:
+  static constexpr uint32_t kScanInterval = 64;
+
+  //
+  // Guard: the calling thread may read retired-but-not-deleted Nodes while it lives.
+  // Guards nest.
+  //
+  class Guard
+  {
+  public:
+    Guard();
+    ~Guard();
+
+    Guard(const Guard &other) = delete;
+    Guard &operator=(const Guard &other) = delete;
+  };
+
+  //
+  // @brief: Delete object with deleter once no Guard can be reading it any more.
+  //
+  static void Retire(void *object, void (*deleter)(void *));
+
+  template <typename T>
+  static void Retire(T *object)
+  {
+    Retire(object, [](void *retired) { delete static_cast<T *>(retired); });
+  }
+
+  //
+  // @brief: Objects retired and not deleted yet, over every thread.
+  //
+  static uint64_t pending();
+};
+} // namespace job_manager
+} // namespace vm
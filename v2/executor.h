@@ -0,0 +1,171 @@
+#pragma once
+
+#include "clock.h"
+#include "time_point_task.h"
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Executor policies of the TaskPool.
+//
+// The worker hands every Task it takes out of the Pending-Queue to the Executor. An
+// Executor must never run a Task before its time_point: depending on the Wait policy a
+// worker may hand over a Task that is not due yet (Version-1 pops whatever is at the head).
+//
+
+//
+// @brief: Requirements on an Executor policy
+//    execute: run (or arrange to run) the task, not earlier than its time_point
+//    drain:   block until every task handed to execute has finished
+//
+template <typename E>
+concept Executor = requires(E &executor, TimePointTask &&task) {
+  executor.execute(std::move(task));
+  executor.drain();
+};
+
+//
+// InlineExecutor: run the Task on the worker thread itself. The worker is busy for the
+// whole duration of the Task, so the number of Tasks running in parallel is bounded by the
+// number of workers of the Pool.
+//
+template <Clock Clk = SteadyClock>
+class InlineExecutor
+{
+public:
+  using clock_type = Clk;
+
+  void execute(TimePointTask &&task)
+  {
+    const Task::time_point_t time_to_run = task.GetRunTimePoint();
+    if (time_to_run > Clk::now())
+    {
+      Clk::sleep_until(time_to_run);
+    }
+    task();
+  }
+
+  void drain() {}
+};
+
+//
+// AsyncExecutor: Version-0/1 fire-and-forget execution. Every Task runs on its own
+// thread, which frees the worker immediately but costs a thread per Task.
+//
+// Each of those threads is a participant of the Clock until its Task returns, so a
+// VirtualClock does not move on while a Task is still running.
+//
+template <Clock Clk = SteadyClock>
+class AsyncExecutor
+{
+public:
+  using clock_type = Clk;
+
+  ~AsyncExecutor()
+  {
+    drain();
+  }
+
+  //
+  // @brief: Fire-and-forget the task on a thread of its own.
+  //    Version-0/1 kept a std::async future alive by capturing a shared_ptr to it inside its
+  //    own callable; that cycle is never broken, so every Task leaked its async state and
+  //    its never-joined thread. A std::thread per Task gives the same non-blocking behaviour
+  //    without the leak. The Task is moved into the thread, it must not refer to the
+  //    (already recycled) storage of the worker.
+  //
+  //    The threads are not detached, so that drain() really waits for every Task: a
+  //    detached thread still unlocks mutex_ and unwinds after it drops in_flight_ to 0, and
+  //    would touch a destroyed Executor once drain() lets the Pool go. A finished thread
+  //    queues itself on finished_ instead, and is joined by the next execute (or drain).
+  //
+  void execute(TimePointTask &&task)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    reap(lock);
+    ++in_flight_;
+    Clk::add_participants(1);
+    const auto self = threads_.emplace(threads_.end());
+    *self = std::thread([this, self, task = std::move(task)]() mutable {
+      const Task::time_point_t time_to_run = task.GetRunTimePoint();
+      if (time_to_run > Clk::now())
+      {
+        Clk::sleep_until(time_to_run);
+      }
+      task();
+      Clk::remove_participant();
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_.push_back(self);
+      if (--in_flight_ == 0)
+      {
+        drained_cv_.notify_all();
+      }
+    });
+  }
+
+  //
+  // @brief: Wait for every fire-and-forget Task to finish.
+  //
+  void drain()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    drained_cv_.wait(lock, [this](){ return in_flight_ == 0; });
+    reap(lock);
+  }
+
+  //
+  // @brief: Number of Tasks handed to execute that have not returned yet.
+  //
+  size_t in_flight() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_;
+  }
+
+private:
+  using thread_list_t = std::list<std::thread>;
+
+  //
+  // @brief: Join the threads that reported themselves finished. lock is released meanwhile.
+  //
+  void reap(std::unique_lock<std::mutex> &lock)
+  {
+    if (finished_.empty())
+    {
+      return;
+    }
+    std::vector<std::thread> joinable;
+    joinable.reserve(finished_.size());
+    for (thread_list_t::iterator thread : finished_)
+    {
+      joinable.push_back(std::move(*thread));
+      threads_.erase(thread);
+    }
+    finished_.clear();
+
+    lock.unlock();
+    for (std::thread &thread : joinable)
+    {
+      thread.join();
+    }
+    lock.lock();
+  }
+
+  mutable std::mutex mutex_; // Guards in_flight_, threads_ and finished_
+  std::condition_variable drained_cv_; // Signaled when the last in-flight Task finishes
+  size_t in_flight_{0}; // Number of Tasks running on async threads
+  thread_list_t threads_; // Threads not joined yet, one per Task
+  std::vector<thread_list_t::iterator> finished_; // Threads whose Task returned, to be joined
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "pending_queue.h"
+#include "time_point_task.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// FixedQueue: Pending-Queue with storage for a fixed number of Tasks, allocated up front.
+//
+// A binary heap of (time_point, sequence, slot) keys over a slab of function objects. Both
+// are sized by reserve (kDefaultCapacity until then) and never grow: once the queue is full,
+// insert throws std::length_error instead of allocating. Moving a std::function in and out of
+// the slab does not allocate either, so insert and pop run in O(log n) with a bounded worst
+// case. The sequence number keeps Tasks with the same time_point in FIFO order, like SetQueue.
+//
+// Deadlines keep their full steady_clock resolution, unlike the Tick-rounded CompactQueue.
+//
+// The queue of the real-time mode of the TaskPool (see realtime.h), where the CallableArena
+// bounds the Jobs in flight so that insert never finds it full. Like SetQueue, it is an
+// OrderedPendingQueue guarded by the Wait policy.
+//
+class FixedQueue
+{
+public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  FixedQueue()
+  {
+    reserve(kDefaultCapacity);
+  }
+
+  //
+  // @brief: Allocate (and touch) storage for capacity Tasks. The queue must be empty.
+  //
+  void reserve(size_t capacity)
+  {
+    keys_ = std::vector<Key>(capacity);
+    keys_.clear();
+    payloads_ = std::vector<Task::task_t>(capacity);
+    free_ = std::vector<uint32_t>(capacity);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+      free_[i] = static_cast<uint32_t>(capacity - 1 - i);
+    }
+  }
+
+  size_t capacity() const
+  {
+    return payloads_.size();
+  }
+
+  size_t size() const
+  {
+    return keys_.size();
+  }
+
+  void insert(TimePointTask &&task)
+  {
+    if (free_.empty())
+    {
+      throw std::length_error("FixedQueue: full");
+    }
+    const uint32_t slot = free_.back();
+    free_.pop_back();
+    payloads_[slot] = task.ReleaseTask();
+    keys_.push_back({task.GetRunTimePoint(), sequence_++, slot});
+    sift_up(keys_.size() - 1);
+  }
+
+  bool empty() const
+  {
+    return keys_.empty();
+  }
+
+  //
+  // @brief: time_point of the earliest Task. The queue must not be empty.
+  //
+  Task::time_point_t earliest() const
+  {
+    return keys_.front().time_point;
+  }
+
+  //
+  // @brief: Remove and return the earliest Task. The queue must not be empty.
+  //
+  TimePointTask pop_front()
+  {
+    const Key key = keys_.front();
+    keys_.front() = keys_.back();
+    keys_.pop_back();
+    if (!keys_.empty())
+    {
+      sift_down(0);
+    }
+    free_.push_back(key.slot);
+    return TimePointTask(key.time_point, std::move(payloads_[key.slot]));
+  }
+
+  //
+  // @brief: Move up to max_count Tasks that are due at now into out.
+  // @return: number of Tasks appended to out
+  //
+  template <typename Container>
+  size_t pop_until(const Task::time_point_t &now, Container &out, size_t max_count)
+  {
+    size_t count = 0;
+    while (count < max_count && !empty() && earliest() <= now)
+    {
+      out.emplace_back(pop_front());
+      ++count;
+    }
+    return count;
+  }
+
+  void clear()
+  {
+    while (!keys_.empty())
+    {
+      free_.push_back(keys_.back().slot);
+      payloads_[keys_.back().slot] = nullptr;
+      keys_.pop_back();
+    }
+  }
+
+private:
+  struct Key
+  {
+    Task::time_point_t time_point;
+    uint64_t sequence; // Order of insertion, among equal time_points
+    uint32_t slot; // Index of the function object in payloads_
+
+    bool operator<(const Key &other) const
+    {
+      return time_point < other.time_point || (time_point == other.time_point && sequence < other.sequence);
+    }
+  };
+
+  void sift_up(size_t index)
+  {
+    const Key key = keys_[index];
+    while (index > 0)
+    {
+      const size_t parent = (index - 1) / 2;
+      if (!(key < keys_[parent]))
+      {
+        break;
+      }
+      keys_[index] = keys_[parent];
+      index = parent;
+    }
+    keys_[index] = key;
+  }
+
+  void sift_down(size_t index)
+  {
+    const Key key = keys_[index];
+    const size_t size = keys_.size();
+    for (;;)
+    {
+      size_t child = 2 * index + 1;
+      if (child >= size)
+      {
+        break;
+      }
+      if (child + 1 < size && keys_[child + 1] < keys_[child])
+      {
+        ++child;
+      }
+      if (!(keys_[child] < key))
+      {
+        break;
+      }
+      keys_[index] = keys_[child];
+      index = child;
+    }
+    keys_[index] = key;
+  }
+
+  std::vector<Key> keys_; // Heap of keys, capacity() reserved
+  std::vector<Task::task_t> payloads_; // Slab of function objects, one per slot
+  std::vector<uint32_t> free_; // Free slots of payloads_, capacity() reserved
+  uint64_t sequence_{0};
+};
+
+static_assert(OrderedPendingQueue<FixedQueue>);
+static_assert(BatchPendingQueue<FixedQueue>);
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,366 @@
+#pragma once
+#include "parallel_for.h"
+#include "strand.h"
+#include "task_pool.h"
+#include "trace.h"
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// BasicJobManager is the User-level API on top of any TaskPool combination.
+// Most users want the JobManager alias below; the other aliases at the bottom of the file
+// select the Version-1 backend (or build your own TaskPool<Queue, Wait, Executor>).
+//
+template <typename Pool>
+class BasicJobManager
+{
+public:
+  using pool_type = Pool;
+  using clock_type = typename Pool::clock_type;
+
+  /* class constructor; creates a pool of 4 threads that start waiting
+  * for jobs to be ran. See description of QueueJob for details.
+  */
+  BasicJobManager()
+    : strands_([this](std::function<void(void)> &&job) { task_pool_->AddJob(clock_type::now(), std::move(job)); }),
+      task_pool_(std::make_unique<Pool>(4))
+  {
+  }
+
+  /* class destructor; waits until all currently running job finish,
+  * then cleans up pool of 4 threads and releases any resources.
+  */
+  ~BasicJobManager() = default;
+
+  /* Queues a job and its corresponding execution time in a list. The
+  * job manager will run the job when the system time reaches
+  * 'time_to_run'.
+  *
+  * Jobs can be queued from multiple threads and out of order. For example,
+  * it's possible that thread A queues a job that needs to run tomorrow
+  * at 10:10 am and later thread B queues a job that needs to run tomorrow
+  * at 9 am.
+  *
+  * Jobs with 'time_to_run' values in the past should run immediately.
+  *
+  * Once the job is executed, it is removed from the list to limit
+  * memory consumption.
+  *
+  * In order to avoid execution delays the JobManager uses a thread
+  * pool of 4 threads to run jobs. This allows up to 4 jobs to run
+  * in parallel.
+  *
+  * For best use of system resources threads should wait on
+  * synchronization objects when they're not running a job.
+  *
+  * INPUT PARAMETERS
+  * time_to_run: absolute time since epoch when the job needs to run.
+  * job: function object that should be called to run the job.
+  */
+  void QueueJob(std::chrono::steady_clock::time_point time_to_run,
+                std::function<void(void)> job) const
+  {
+    if (trace_)
+    {
+      job = Traced(time_to_run, std::move(job));
+    }
+    task_pool_->AddJob(std::move(time_to_run), std::move(job));
+  }
+
+  /* Queues a job like QueueJob, with a policy for when it is taken
+  * out of the list late, e.g. after a stall: run it anyway, drop it
+  * past a budget, run only the latest job of its key, or queue it
+  * again behind the jobs that are on time (see lateness.h). Dropped
+  * and coalesced jobs are counted in Snapshot().
+  */
+  void QueueJob(std::chrono::steady_clock::time_point time_to_run,
+                std::function<void(void)> job, const LatenessPolicy &policy) const
+  {
+    if (trace_)
+    {
+      job = Traced(time_to_run, std::move(job));
+    }
+    task_pool_->AddJob(time_to_run, std::move(job), policy);
+  }
+
+  /* Queues a job like QueueJob, with a hint on where to run it:
+  * kInline runs it on the pool thread that takes it out of the list
+  * instead of handing it off (for jobs of a few hundred nanoseconds),
+  * kPooled always hands it off, and kAuto follows the cost estimator
+  * (see EnableCostEstimator and cost_estimator.h).
+  */
+  void QueueJob(std::chrono::steady_clock::time_point time_to_run,
+                std::function<void(void)> job, ExecutionHint hint) const
+  {
+    if (trace_)
+    {
+      job = Traced(time_to_run, std::move(job));
+    }
+    task_pool_->AddJob(time_to_run, std::move(job), hint);
+  }
+
+  /*
+  * Measure how long every kind of job (every lambda of the code)
+  * takes, and run the kinds that take 'cheap' or less on the pool
+  * threads themselves. Every pool thread wake-up runs at most
+  * 'budget' worth of jobs inline, the rest is handed off as usual.
+  */
+  void EnableCostEstimator(std::chrono::nanoseconds cheap = std::chrono::microseconds(2),
+                           std::chrono::nanoseconds budget = std::chrono::microseconds(50)) const
+  {
+    task_pool_->SetInlineBudget(budget);
+    task_pool_->EnableCostEstimator(cheap);
+  }
+
+  /* Queues a job like QueueJob, on the strand of 'key': jobs queued
+  * with the same key never run concurrently, and run in the order of
+  * their 'time_to_run'. Jobs with different keys still run in
+  * parallel. A strand takes up at most one of the pool threads at a
+  * time, so jobs that share state through their key need no lock of
+  * their own and do not hold up the other threads (see strand.h).
+  */
+  void QueueJob(uint64_t key, std::chrono::steady_clock::time_point time_to_run,
+                std::function<void(void)> job) const
+  {
+    if (trace_)
+    {
+      job = Traced(time_to_run, std::move(job));
+    }
+    job = strands_.Wrap(key, time_to_run, std::move(job));
+    task_pool_->AddJob(std::move(time_to_run), std::move(job));
+  }
+
+  /*
+  * Queues a data-parallel job: at 'time_to_run', 'range' is cut into
+  * chunks of 'grain' indices, and body(begin, end) runs the chunks on
+  * every pool thread at once, which steal chunks from each other as
+  * they run out (see parallel_for.h). 'done', if set, runs once after
+  * the last chunk, on the thread that ran it.
+  */
+  void QueueParallelFor(std::chrono::steady_clock::time_point time_to_run, IndexRange range, size_t grain,
+                        ParallelFor::body_t body, ParallelFor::done_t done = {}) const
+  {
+    Task::task_t job = ParallelFor::Wrap(
+      [this](Task::task_t &&helper) { task_pool_->AddJob(clock_type::now(), std::move(helper)); },
+      task_pool_->Workers(), range, grain, std::move(body), std::move(done));
+    QueueJob(time_to_run, std::move(job));
+  }
+
+  /*
+  * Queues deferrable work with no deadline. It runs on one pool
+  * thread, only while no timed job is due within the horizon (see
+  * SetBackground), and should call check.ShouldYield() between chunks
+  * of its work: on true it returns false, and is resumed later. It
+  * returns true once it is done (see background.h).
+  */
+  void QueueBackgroundJob(BackgroundJob job) const
+  {
+    task_pool_->AddBackgroundJob(std::move(job));
+  }
+
+  /*
+  * How close to a timed job background jobs stop running. Call it
+  * before the first QueueBackgroundJob.
+  */
+  void SetBackground(const BackgroundOptions &options) const
+  {
+    task_pool_->SetBackground(options);
+  }
+
+  /*
+  * Record every Job queued from now on into a binary trace at 'path'
+  * (see trace.h). Call it before queuing Jobs, it must not race with
+  * QueueJob. Throws std::runtime_error if the file cannot be created.
+  */
+  void StartTrace(const std::string &path)
+  {
+    trace_ = std::make_shared<TraceRecorder>(path);
+  }
+
+  /*
+  * Stop recording. The trace file is complete once the Jobs queued
+  * while recording have run (or End dropped them).
+  */
+  void StopTrace()
+  {
+    trace_.reset();
+  }
+
+  /*
+  * Record which thread runs what, and when, from now on: QueueJob
+  * calls, job runs, worker idle waits and dequeues (see timeline.h).
+  */
+  void StartTimeline() const
+  {
+    task_pool_->StartTimeline();
+  }
+
+  /*
+  * Stop recording and write the timeline to 'path' as Chrome
+  * trace-event JSON, for Perfetto (ui.perfetto.dev) or
+  * chrome://tracing. Returns false if the file could not be written.
+  */
+  bool StopTimeline(const std::string &path) const
+  {
+    return task_pool_->StopTimeline(path);
+  }
+
+  /*
+  * Point-in-time view of the pool: submitted, pending and in-flight
+  * jobs, and per-worker executed jobs, busy/idle time and wake-ups.
+  * The counters are always on; reading them does not block the pool.
+  */
+  PoolSnapshot Snapshot() const
+  {
+    return task_pool_->Snapshot();
+  }
+
+  /*
+  * Lock contention statistics of the pool, one LockSite per lock
+  * site. Only filled in for the Profiled backends.
+  */
+  std::vector<const LockSite *> LockSites() const
+  {
+    return task_pool_->LockSites();
+  }
+
+  /*
+  * Write Snapshot() to 'path' in Prometheus text format every
+  * 'interval', until StopMetricsDump (or destruction).
+  */
+  void StartMetricsDump(const std::string &path,
+                        std::chrono::milliseconds interval = std::chrono::seconds(10))
+  {
+    metrics_.reset();
+    metrics_ = std::make_unique<MetricsDumper>(path, interval, [this]() { return Snapshot(); });
+  }
+
+  /*
+  * Stop the periodic dump, after writing one last snapshot.
+  */
+  void StopMetricsDump()
+  {
+    metrics_.reset();
+  }
+
+  /*
+  * Let the pool grow from 'options.min_workers' up to
+  * 'options.max_workers' threads while jobs wait or every thread is
+  * busy, and shrink back once threads have been idle for a while
+  * (see elastic.h). Call it before Start.
+  */
+  void SetElastic(const ElasticOptions &options) const
+  {
+    task_pool_->SetElastic(options);
+  }
+
+  /*
+  * Preallocate storage for 'options.capacity' jobs, lock memory and
+  * optionally run the pool threads under SCHED_FIFO (see realtime.h).
+  * The pool then runs 'options.workers' threads, a single dispatcher
+  * by default, instead of 4.
+  * QueueJob then throws std::length_error instead of allocating once
+  * the storage is used up; TryQueueJob returns false. Call it before
+  * Start, on a backend with a fixed-size queue (RealtimeJobManager).
+  * Realtime() reports which settings could not be applied.
+  *
+  * QueueJob takes a std::function, so the caller has already built
+  * it, and allocated for any callable capturing more than two
+  * pointers, before the pool sees it; after StartTrace it allocates
+  * the tracing wrapper too. Submissions that must not allocate go
+  * through TryQueueJob.
+  */
+  void SetRealtime(const RealtimeOptions &options) const
+  {
+    task_pool_->SetRealtime(options);
+  }
+
+  RealtimeStatus Realtime() const
+  {
+    return task_pool_->Realtime();
+  }
+
+  /*
+  * Queues any callable like QueueJob, without going through a
+  * std::function: in real-time mode it is constructed straight into
+  * the preallocated storage, and nothing is allocated. Returns false
+  * if the storage is used up.
+  */
+  template <typename F>
+  bool TryQueueJob(std::chrono::steady_clock::time_point time_to_run, F &&job) const
+  {
+    return task_pool_->TryAddJob(time_to_run, std::forward<F>(job));
+  }
+
+  /*
+  * Start the JobManager
+  */
+  void Start() const
+  {
+    task_pool_->StartProcessingJobs();
+  }
+
+  /*
+  * End the JobManager
+  */
+  void End() const
+  {
+    task_pool_->EndProcessing();
+  }
+
+private:
+  //
+  // @brief: Wrap job so that it appends its TraceRecord once it has run. The Job keeps the
+  //    recorder alive, so StopTrace does not cut off Jobs that are still pending. The
+  //    KindedJob keeps the kind of job for the CostEstimator.
+  //
+  std::function<void(void)> Traced(const std::chrono::steady_clock::time_point &time_to_run,
+                                    std::function<void(void)> &&job) const
+  {
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    const Task::time_point_t submit = clock_type::now();
+    TraceRecord record{duration_cast<nanoseconds>(submit.time_since_epoch()).count(),
+                       duration_cast<nanoseconds>(time_to_run - submit).count(),
+                       0,
+                       ThreadIndex(),
+                       0};
+    const std::type_info &kind = KindOf(job);
+    return KindedJob{&kind, [trace = trace_, job = std::move(job), record]() mutable {
+      const Task::time_point_t begin = Task::clock_t::now();
+      job();
+      record.duration_ns = duration_cast<nanoseconds>(Task::clock_t::now() - begin).count();
+      trace->Append(record);
+    }};
+  }
+
+  mutable Strands strands_; // Strands of the keyed QueueJob, outlive the pool that runs their Jobs
+  std::unique_ptr<Pool> task_pool_; // Unique_Ptr to the TaskPool Implementation (PIMPL)
+  std::shared_ptr<TraceRecorder> trace_; // Set while recording a trace
+  std::unique_ptr<MetricsDumper> metrics_; // Set while dumping metrics, stopped before the pool goes
+};
+
+using JobManager = BasicJobManager<SetTaskPool>; // Version-0 backend
+using ListJobManager = BasicJobManager<ListTaskPool>; // Version-1 backend
+using LazyListJobManager = BasicJobManager<LazyListTaskPool>; // Version-1 list, lazy synchronization
+using CompactJobManager = BasicJobManager<CompactTaskPool>; // Struct-of-arrays backend
+using BlockJobManager = BasicJobManager<BlockTaskPool>; // Bulk SIMD-scanned backend
+using BucketJobManager = BasicJobManager<BucketTaskPool>; // Same-deadline bucketing backend
+using VirtualJobManager = BasicJobManager<VirtualTaskPool>; // Version-0 backend on simulated time
+using PreciseJobManager = BasicJobManager<PreciseTaskPool>; // Version-0 backend, sleep-then-spin dispatch
+using RealtimeJobManager = BasicJobManager<RealtimeTaskPool>; // Preallocated backend, see SetRealtime
+using ProfiledJobManager = BasicJobManager<ProfiledSetTaskPool>; // Version-0 backend, lock profiling
+using ProfiledListJobManager = BasicJobManager<ProfiledListTaskPool>; // Version-1 backend, lock profiling
+using TimelineJobManager = BasicJobManager<TimelineSetTaskPool>; // Version-0 backend, lock waits in the timeline
+using TimelineListJobManager = BasicJobManager<TimelineListTaskPool>; // Version-1 backend, lock waits in the timeline
+} // namespace job_manager
+} // namespace vm
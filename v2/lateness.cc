@@ -0,0 +1,36 @@
+#include "lateness.h"
+
+namespace vm
+{
+namespace job_manager
+{
+uint64_t Coalescer::Submit(uint64_t key, const Task::time_point_t &time_to_run)
+{
+  const uint64_t sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+  Shard &shard = ShardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto [entry, added] = shard.latest.try_emplace(key, Latest{time_to_run, sequence});
+  Latest &latest = entry->second;
+  if (!added && (time_to_run > latest.time_to_run || (time_to_run == latest.time_to_run && sequence > latest.sequence)))
+  {
+    latest = {time_to_run, sequence};
+  }
+  return sequence;
+}
+
+bool Coalescer::Superseded(uint64_t key, const Task::time_point_t &time_to_run, uint64_t sequence,
+                           const Task::time_point_t &now) const
+{
+  const Shard &shard = ShardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto entry = shard.latest.find(key);
+  if (entry == shard.latest.end())
+  {
+    return false;
+  }
+  const Latest &latest = entry->second;
+  const bool later = latest.time_to_run > time_to_run || (latest.time_to_run == time_to_run && latest.sequence > sequence);
+  return later && latest.time_to_run <= now;
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Lateness policies: what the TaskPool does with a Job that comes out of the queue later
+// than its time_point.
+//
+// After a stall (a long GC-style pause, a suspended VM) every Job that fell due meanwhile
+// is late at once. Running them all back to back is the QueueJob contract, but it holds up
+// the Jobs that are due now for as long as the backlog takes to run. A Job queued with a
+// LatenessPolicy says what it is worth once late:
+//  - Always:       run it anyway (the default, and what QueueJob without a policy does)
+//  - DropAfter:    drop it if it is later than budget
+//  - Coalesce:     drop it if a Job of the same key with a later time_point is due too, so
+//                  only the latest Job of the key runs
+//  - Deprioritize: if it is later than budget, queue it again budget from now, behind the
+//                  Jobs due meanwhile. It runs on its next turn, whatever its lateness then.
+//
+// The policy is checked when a worker takes the Job out of the queue, before the Executor
+// sees it: a dropped Job does not cost an async thread either.
+//
+struct LatenessPolicy
+{
+  enum class Action : uint8_t
+  {
+    kRun,
+    kDrop,
+    kCoalesce,
+    kDeprioritize,
+  };
+
+  static LatenessPolicy Always() { return {}; }
+  static LatenessPolicy DropAfter(std::chrono::nanoseconds budget) { return {Action::kDrop, budget, 0}; }
+  static LatenessPolicy Coalesce(uint64_t key) { return {Action::kCoalesce, std::chrono::nanoseconds(0), key}; }
+  static LatenessPolicy Deprioritize(std::chrono::nanoseconds budget) { return {Action::kDeprioritize, budget, 0}; }
+
+  Action action{Action::kRun};
+  std::chrono::nanoseconds budget{0}; // Lateness tolerated by kDrop and kDeprioritize
+  uint64_t key{0}; // Kind of the Job, for kCoalesce
+};
+
+//
+// LateJob: the callable a Job with a LatenessPolicy is queued as. The worker recognizes it
+// (std::function::target) and applies the policy; it runs like the Job otherwise. It keeps
+// the time_point of its own: the compact Pending-Queues round time_points up to their Tick.
+//
+struct LateJob
+{
+  void operator()() { job(); }
+
+  LatenessPolicy policy;
+  Task::time_point_t time_to_run;
+  uint64_t sequence{0}; // Submission order of the key, for kCoalesce
+  bool deprioritized{false}; // Queued again once already
+  const std::type_info *kind{&typeid(void)}; // KindOf the Job it wraps, for the CostEstimator
+  Task::task_t job;
+};
+
+//
+// Coalescer: the latest Job (by time_point, then submission order) queued for every
+// coalescing key. Keys are kinds of Jobs, not Jobs: an entry stays for the life of the Pool.
+//
+class Coalescer
+{
+public:
+  static constexpr size_t kShards = 16;
+
+  //
+  // @brief: Record a Job of key due at time_to_run. Returns its sequence.
+  //
+  uint64_t Submit(uint64_t key, const Task::time_point_t &time_to_run);
+
+  //
+  // @brief: Whether a later Job of key than (time_to_run, sequence) was queued and is due
+  //    at now.
+  //
+  bool Superseded(uint64_t key, const Task::time_point_t &time_to_run, uint64_t sequence,
+                  const Task::time_point_t &now) const;
+
+private:
+  struct Latest
+  {
+    Task::time_point_t time_to_run;
+    uint64_t sequence{0};
+  };
+
+  struct alignas(64) Shard
+  {
+    mutable std::mutex mutex; // Guards latest
+    std::unordered_map<uint64_t, Latest> latest;
+  };
+
+  Shard &ShardOf(uint64_t key) { return shards_[key % kShards]; }
+  const Shard &ShardOf(uint64_t key) const { return shards_[key % kShards]; }
+
+  std::atomic<uint64_t> sequence_{0};
+  std::array<Shard, kShards> shards_;
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "epoch.h"
+#include "lock_profile.h"
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// LazyOrderedList: ordered list with lazy synchronization, a drop-in alternative to the
+// hand-over-hand locked ThreadSafeOrderedList.
+//
+// A Writer-Thread of ThreadSafeOrderedList locks every Node it walks past, so a deep insert
+// takes O(n) mutex acquisitions and holds up every Writer-Thread behind it. Here an insert
+// walks the List without taking any lock, then locks only the predecessor and the successor
+// of its position and validates them: neither is removed, and the predecessor still links
+// to the successor. If the validation fails (a Reader-Thread popped the predecessor, or
+// another insert got in between) the insert walks again from the head.
+//
+// Nodes only ever leave the List at the head, under head.m and their own mutex: they are
+// marked as removed first, then unlinked. A Writer-Thread may still be walking over an
+// unlinked Node, so Nodes are not deleted but retired to the EpochReclaimer (epoch.h), and
+// the walk happens inside an EpochReclaimer::Guard.
+//
+// The walk compares against the Nodes of other threads without locking them, so the List
+// orders its data by a copy of GetRunTimePoint() taken at insert, which never changes; the
+// data itself is only touched by whoever pops it. Equal time_points are inserted in front of
+// each other, like ThreadSafeOrderedList does.
+//
+template <typename T, typename Site = NoLockSite>
+  requires requires(const T &data) { data.GetRunTimePoint(); }
+class LazyOrderedList
+{
+public:
+  using time_point = std::remove_cvref_t<decltype(std::declval<const T &>().GetRunTimePoint())>;
+
+  LazyOrderedList() = default;
+  ~LazyOrderedList()
+  {
+    // Nobody else uses the List any more: the Nodes can go straight away.
+    Node *node = head.next.load(std::memory_order_relaxed);
+    while (node)
+    {
+      Node *next = node->next.load(std::memory_order_relaxed);
+      delete node;
+      node = next;
+    }
+  }
+  LazyOrderedList(const LazyOrderedList &other) = delete;
+  LazyOrderedList &operator=(const LazyOrderedList &other) = delete;
+
+  //
+  // @return: true if data became the first Node of the List
+  //
+  bool insert(const T &data)
+  {
+    return do_insert(new Node(data));
+  }
+
+  //
+  // @return: true if data became the first Node of the List
+  //
+  bool insert(T &&data)
+  {
+    return do_insert(new Node(std::move(data)));
+  }
+
+  //
+  // @brief: time_point of the first Node, std::nullopt if the List is empty. Lock-free, a
+  //    hint to re-check with pop_until (see ThreadSafeOrderedList::peek_deadline).
+  //
+  std::optional<time_point> peek_deadline() const
+  {
+    const int64_t deadline = head_deadline_.load();
+    if (deadline == kNoDeadline)
+    {
+      return std::nullopt;
+    }
+    return time_point(std::chrono::duration_cast<typename time_point::duration>(std::chrono::nanoseconds(deadline)));
+  }
+
+  //
+  // @brief: Pop the first Node of the List, whether it is due or not.
+  //
+  std::unique_ptr<T> pop()
+  {
+    Node *first = nullptr;
+    {
+      lock_t lock(head.m, pop_site_, 0);
+      first = head.next.load(std::memory_order_relaxed);
+      if (!first)
+      {
+        return std::unique_ptr<T>{};
+      }
+      lock_t first_lock(first->m, pop_site_, 1);
+      first->marked.store(true, std::memory_order_relaxed);
+      head.next.store(first->next.load(std::memory_order_relaxed), std::memory_order_release);
+      publish_head();
+    }
+    std::unique_ptr<T> result = std::make_unique<T>(std::move(first->data));
+    EpochReclaimer::Retire(first);
+    return result;
+  }
+
+  //
+  // @brief: Pop the whole due prefix of the List in one go, up to max_count Nodes, under a
+  //    single acquisition of head.m (see ThreadSafeOrderedList::pop_until). Every Node of
+  //    the prefix is marked under its own mutex, so that no insert links in behind it
+  //    anymore, before the prefix is unlinked.
+  //
+  template <typename TimePoint, typename Container>
+  size_t pop_until(const TimePoint &now, Container &out, size_t max_count)
+  {
+    Node *first = nullptr;
+    size_t count = 0;
+    {
+      lock_t lock(head.m, pop_until_site_, 0);
+      first = head.next.load(std::memory_order_relaxed);
+      Node *next = first;
+      while (next && count < max_count && next->key <= now)
+      {
+        lock_t next_lock(next->m, pop_until_site_, count + 1);
+        next->marked.store(true, std::memory_order_relaxed);
+        next = next->next.load(std::memory_order_relaxed);
+        ++count;
+      }
+      if (count == 0)
+      {
+        return 0;
+      }
+      head.next.store(next, std::memory_order_release);
+      publish_head();
+    }
+
+    // The prefix is out of the List, and its links cannot change any more.
+    Node *node = first;
+    for (size_t i = 0; i < count; ++i)
+    {
+      Node *next = node->next.load(std::memory_order_relaxed);
+      out.emplace_back(std::move(node->data));
+      EpochReclaimer::Retire(node);
+      node = next;
+    }
+    return count;
+  }
+
+  //
+  // @brief: Drop every Node of the List.
+  //
+  void clear()
+  {
+    Node *first = nullptr;
+    {
+      lock_t lock(head.m, clear_site_, 0);
+      first = head.next.load(std::memory_order_relaxed);
+      for (Node *node = first; node; node = node->next.load(std::memory_order_relaxed))
+      {
+        lock_t node_lock(node->m, clear_site_, 1);
+        node->marked.store(true, std::memory_order_relaxed);
+      }
+      head.next.store(nullptr, std::memory_order_release);
+      publish_head();
+    }
+    while (first)
+    {
+      Node *next = first->next.load(std::memory_order_relaxed);
+      EpochReclaimer::Retire(first);
+      first = next;
+    }
+  }
+
+  //
+  // @brief: Inserts that failed validation and walked the List again.
+  //
+  uint64_t retries() const
+  {
+    return retries_.load(std::memory_order_relaxed);
+  }
+
+  //
+  // @brief: The lock sites of the List, for reporting. Only with lock profiling enabled.
+  //
+  std::vector<const LockSite *> lock_sites() const
+    requires std::same_as<Site, LockSite>
+  {
+    return {&insert_site_, &pop_site_, &pop_until_site_, &clear_site_};
+  }
+
+private:
+  struct Node;
+
+  //
+  // The part of a Node an insert links in behind; all of the head.
+  //
+  struct Link
+  {
+    std::mutex m; // Held to link in behind, or to mark the Node
+    std::atomic<Node *> next{nullptr};
+    std::atomic<bool> marked{false}; // Removed from the List, set before it is unlinked
+  };
+
+  struct Node : Link
+  {
+    template <typename U>
+    explicit Node(U &&value) : data(std::forward<U>(value)), key(data.GetRunTimePoint()) {}
+
+    T data; // Moved out by the Reader-Thread that popped the Node
+    const time_point key; // Copy of data.GetRunTimePoint(), read by the walks
+  };
+
+  //
+  // @brief: Link node in at its position: walk without locks, lock the predecessor and the
+  //    successor, validate, retry from the head if a concurrent pop or insert got in the way.
+  // @return: true if node became the first Node of the List
+  //
+  bool do_insert(Node *node)
+  {
+    EpochReclaimer::Guard guard;
+    for (;;)
+    {
+      Link *predecessor = &head;
+      Node *successor = head.next.load(std::memory_order_acquire);
+      size_t depth = 0;
+      while (successor && node->key > successor->key)
+      {
+        predecessor = successor;
+        successor = successor->next.load(std::memory_order_acquire);
+        ++depth;
+      }
+
+      lock_t predecessor_lock(predecessor->m, insert_site_, depth);
+      lock_t successor_lock;
+      if (successor)
+      {
+        successor_lock = lock_t(successor->m, insert_site_, depth + 1);
+      }
+      if (!predecessor->marked.load(std::memory_order_relaxed)
+          && (!successor || !successor->marked.load(std::memory_order_relaxed))
+          && predecessor->next.load(std::memory_order_relaxed) == successor)
+      {
+        node->next.store(successor, std::memory_order_relaxed);
+        predecessor->next.store(node, std::memory_order_release);
+        if (predecessor != &head)
+        {
+          return false;
+        }
+        publish_head();
+        return true;
+      }
+      retries_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  //
+  // @brief: Refresh head_deadline_ after the first Node changed. head.m must be held.
+  //
+  void publish_head()
+  {
+    const Node *first = head.next.load(std::memory_order_relaxed);
+    head_deadline_.store(first
+      ? std::chrono::duration_cast<std::chrono::nanoseconds>(first->key.time_since_epoch()).count()
+      : kNoDeadline);
+  }
+
+  using lock_t = ProfiledLock<Site>;
+
+  static constexpr int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+
+  Link head; // Head of the List, never marked; the Nodes with data start at head.next
+  [[no_unique_address]] Site insert_site_{"lazy_list.insert"};
+  [[no_unique_address]] Site pop_site_{"lazy_list.pop"};
+  [[no_unique_address]] Site pop_until_site_{"lazy_list.pop_until"};
+  [[no_unique_address]] Site clear_site_{"lazy_list.clear"};
+  std::atomic<int64_t> head_deadline_{kNoDeadline}; // ns since epoch of the first Node's time_point
+  std::atomic<uint64_t> retries_{0};
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "lock_profile.h"
+
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <functional>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Site selects lock profiling (lock_profile.h): with LockSite every Node acquisition is
+// recorded per operation, along with the depth of the Node it locks.
+//
+// For data with a GetRunTimePoint() the List keeps an atomic copy of the time_point of its
+// first Node, refreshed under head.m whenever the first Node changes, so that peek_deadline()
+// can tell what is due next without taking any lock.
+//
+template <typename T, typename Site = NoLockSite>
+class ThreadSafeOrderedList
+{
+public:
+  ThreadSafeOrderedList() = default;
+  ~ThreadSafeOrderedList()
+  {
+    clear();
+  }
+  ThreadSafeOrderedList(const ThreadSafeOrderedList &other) = delete;
+  ThreadSafeOrderedList &operator=(const ThreadSafeOrderedList &other) = delete;
+  ThreadSafeOrderedList(ThreadSafeOrderedList &&other) = delete;
+  ThreadSafeOrderedList &operator=(ThreadSafeOrderedList &&other) = delete;
+
+  //
+  // @brief: Utility to re-use insert code effectively
+  // @return: true if data became the first Node of the List
+  //
+  bool insert(const T &data)
+  {
+    return do_insert(data);
+  }
+
+  //
+  // @brief: Utility to re-use insert code effectively
+  // @return: true if data became the first Node of the List
+  //
+  bool insert(T &&data)
+  {
+    return do_insert(std::move(data));
+  }
+
+  //
+  // @brief: time_point of the first Node, std::nullopt if the List is empty. Lock-free: a
+  //    concurrent insert or pop may change it right after, so it is a hint to re-check with
+  //    pop_until, never a promise.
+  //
+  auto peek_deadline() const
+    requires requires(const T &data) { data.GetRunTimePoint(); }
+  {
+    using time_point = std::remove_cvref_t<decltype(std::declval<const T &>().GetRunTimePoint())>;
+    const int64_t deadline = head_deadline_.load();
+    if (deadline == kNoDeadline)
+    {
+      return std::optional<time_point>{};
+    }
+    return std::optional<time_point>(
+      time_point(std::chrono::duration_cast<typename time_point::duration>(std::chrono::nanoseconds(deadline))));
+  }
+
+  //
+  // @brief: Pop the fron of the List
+  //    This List is sorted in the ascending order so, the first Node in the List is
+  //    guaranteed to always return the lowest in order.
+  //
+  //    One drawback here if there are several Reader-Threads able to get the mutex to the
+  //    head one after the other and causing the Writer-Threads to starve will lead to undesired
+  //    behavior. As the writer threads could be trying to insert the Tasks which can be lower
+  //    in the List. This problem can potentially prevented by asigning higher-priority to the
+  //    writer-threads.
+  //
+  //    The first Node is locked as well before it is unlinked: a Writer-Thread that already
+  //    moved past the head may still be holding it while comparing against its data.
+  //
+  std::unique_ptr<T> pop()
+  {
+    lock_t lock(head.m, pop_site_, 0);
+    if (!head.next)
+    {
+      return std::unique_ptr<T>{};
+    }
+
+    lock_t next_lock(head.next->m, pop_site_, 1);
+    std::unique_ptr<Node> next = std::move(head.next);
+    std::unique_ptr<T> result = std::move(next->data);
+    head.next = std::move(next->next);
+    publish_head();
+    next_lock.unlock();
+    return result;
+  }
+
+  //
+  // @brief: Pop the whole due prefix of the List in one go.
+  //    Every Node whose data is due at time_point (data.GetRunTimePoint() <= time_point), up to
+  //    max_count of them, is detached under a single acquisition of head.m: the prefix is
+  //    walked hand-over-hand (a Writer-Thread still working inside it has to be let through)
+  //    and then spliced out of the List by re-pointing head.next past its last Node. The data
+  //    is moved into out after every lock has been released.
+  //
+  //    Unlike pop(), a Node that is not due yet is never taken out of the List.
+  //
+  // @param: time_point: Nodes due at or before this time_point are popped
+  // @param: out: container the data is appended to (emplace_back)
+  // @param: max_count: upper bound on the number of Nodes popped
+  // @return: number of Nodes popped
+  //
+  template <typename TimePoint, typename Container>
+  size_t pop_until(const TimePoint &time_point, Container &out, size_t max_count)
+  {
+    std::unique_ptr<Node> chain;
+    size_t count = 0;
+    {
+      lock_t lock(head.m, pop_until_site_, 0);
+      Node *last = nullptr;
+      lock_t last_lock;
+      Node *next = head.next.get();
+      while (next && count < max_count)
+      {
+        lock_t next_lock(next->m, pop_until_site_, count + 1);
+        if (next->data->GetRunTimePoint() > time_point)
+        {
+          break;
+        }
+        // No Writer-Thread can enter behind us while head.m is held, so the lock on the
+        // previous Node of the prefix can go.
+        last = next;
+        last_lock = std::move(next_lock);
+        next = last->next.get();
+        ++count;
+      }
+
+      if (count == 0)
+      {
+        return 0;
+      }
+      chain = std::move(head.next);
+      head.next = std::move(last->next);
+      publish_head();
+    }
+
+    while (chain)
+    {
+      out.emplace_back(std::move(*(chain->data)));
+      chain = std::move(chain->next);
+    }
+    return count;
+  }
+
+  //
+  // @brief: The lock sites of the List, for reporting. Only with lock profiling enabled.
+  //
+  std::vector<const LockSite *> lock_sites() const
+    requires std::same_as<Site, LockSite>
+  {
+    return {&insert_site_, &pop_site_, &pop_until_site_, &clear_site_};
+  }
+
+  //
+  // @brief: Drop every Node of the List.
+  //    Nodes are released one at a time instead of through the recursive unique_ptr chain,
+  //    so clearing a list with millions of pending Tasks cannot overflow the stack.
+  //
+  void clear()
+  {
+    std::unique_ptr<Node> chain;
+    {
+      lock_t lock(head.m, clear_site_, 0);
+      chain = std::move(head.next);
+      publish_head();
+    }
+    while (chain)
+    {
+      chain = std::move(chain->next);
+    }
+  }
+
+private:
+  struct Node;
+
+  //
+  // @brief: Function responsible to perform the insert operation to the OrderedList
+  //    This OrderedList performs hand-over-hand locking of the Nodes to find the right
+  //    position for the nodes based on theie data-value. This is a neat approach to
+  //    make sure the Writer-threads that need to insert data with lower value can get the
+  //    exclusive access they need, because the other writer-threads trying to insert data
+  //    with large value are working with the later parts of the List
+  //
+  // @param: data to be inserted
+  // @return: true if data became the first Node of the List
+  //
+  template <typename U>
+  bool do_insert(U &&data)
+  {
+    std::unique_ptr<Node> new_task_node(new Node(std::forward<U>(data)));
+    const T &value = *(new_task_node->data);
+    lock_t lock(head.m, insert_site_, 0);
+    Node *current = &head;
+    size_t depth = 0;
+
+    // From the second push
+    while (Node *const next = current->next.get())
+    {
+      lock_t next_lock(next->m, insert_site_, ++depth);
+      if (value <= *(next->data))
+      {
+        return link(current, std::move(new_task_node));
+      }
+
+      lock.unlock();
+      current = next;
+      lock = std::move(next_lock);
+    }
+
+    return link(current, std::move(new_task_node));
+  }
+
+  //
+  // @brief: Link node in behind current, whose mutex must be held.
+  // @return: true if node became the first Node of the List
+  //
+  bool link(Node *current, std::unique_ptr<Node> &&node)
+  {
+    node->next = std::move(current->next);
+    current->next = std::move(node);
+    if (current != &head)
+    {
+      return false;
+    }
+    publish_head();
+    return true;
+  }
+
+  //
+  // @brief: Refresh head_deadline_ after the first Node changed. head.m must be held.
+  //
+  void publish_head()
+  {
+    if constexpr (requires(const T &data) { data.GetRunTimePoint(); })
+    {
+      head_deadline_.store(head.next
+        ? std::chrono::duration_cast<std::chrono::nanoseconds>(head.next->data->GetRunTimePoint().time_since_epoch()).count()
+        : kNoDeadline);
+    }
+  }
+
+  //
+  // Node Structure defines the single block of the OrderedList
+  //
+  struct Node
+  {
+    std::mutex m; // Dedicated mutex on every Node of the List to facilitate "hand-over-hand" locking mechanism
+    std::unique_ptr<T> data; // Unique_pointer for the data
+    std::unique_ptr<Node> next; // Unique_pointer to the next Node in the List
+
+    Node() : data(nullptr), next(nullptr) {}
+    Node(const T &task_value) : data(std::make_unique<T>(task_value)), next(nullptr) {}
+    Node(T &&task_value) : data(std::make_unique<T>(std::move(task_value))), next(nullptr) {}
+  };
+
+  using lock_t = ProfiledLock<Site>;
+
+  static constexpr int64_t kNoDeadline = std::numeric_limits<int64_t>::max();
+
+  Node head; // Head of the List. This is always going to be an empty Node
+             // The actual Node with data are going to starting from Head.next
+  [[no_unique_address]] Site insert_site_{"list.insert"};
+  [[no_unique_address]] Site pop_site_{"list.pop"};
+  [[no_unique_address]] Site pop_until_site_{"list.pop_until"};
+  [[no_unique_address]] Site clear_site_{"list.clear"};
+  std::atomic<int64_t> head_deadline_{kNoDeadline}; // ns since epoch of the first Node's time_point
+
+};
+} // namespace job_manager
+} // namespace vm
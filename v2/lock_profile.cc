@@ -0,0 +1,107 @@
+#include "lock_profile.h"
+
+#include <sstream>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+uint64_t BucketUpper(size_t bucket)
+{
+  return bucket == 0 ? 0 : (uint64_t{1} << bucket) - 1;
+}
+
+uint64_t BucketLower(size_t bucket)
+{
+  return bucket == 0 ? 0 : uint64_t{1} << (bucket - 1);
+}
+} // namespace
+
+uint64_t LatencyHistogram::count() const
+{
+  uint64_t sum = 0;
+  for (const std::atomic<uint64_t> &bucket : buckets_)
+  {
+    sum += bucket.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+uint64_t LatencyHistogram::quantile(double quantile) const
+{
+  const uint64_t total = count();
+  if (total == 0)
+  {
+    return 0;
+  }
+  const uint64_t rank = static_cast<uint64_t>(quantile * (total - 1));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; ++i)
+  {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen > rank)
+    {
+      return BucketUpper(i);
+    }
+  }
+  return BucketUpper(kBuckets - 1);
+}
+
+std::string LatencyHistogram::format() const
+{
+  const uint64_t total = count();
+  std::ostringstream out;
+  for (size_t i = 0; i < kBuckets; ++i)
+  {
+    const uint64_t samples = buckets_[i].load(std::memory_order_relaxed);
+    if (samples == 0)
+    {
+      continue;
+    }
+    out << "    " << BucketLower(i) << ".." << BucketUpper(i) << "ns\t" << samples << '\t'
+        << std::string(static_cast<size_t>(40.0 * samples / total), '#') << '\n';
+  }
+  return out.str();
+}
+
+std::string LockSite::format() const
+{
+  std::ostringstream out;
+  const uint64_t total = acquisitions();
+  out << name_ << ": " << total << " acquisitions, " << contended() << " contended";
+  if (total)
+  {
+    out << " (" << 100.0 * contended() / total << "%)";
+  }
+  out << ", wait p50/p99 " << wait_.quantile(0.5) << '/' << wait_.quantile(0.99) << "ns"
+      << ", hold p50/p99 " << hold_.quantile(0.5) << '/' << hold_.quantile(0.99) << "ns\n";
+  out << "  wait:\n" << wait_.format();
+  out << "  hold:\n" << hold_.format();
+
+  size_t depths = 0;
+  for (const std::atomic<uint64_t> &bucket : depth_acquisitions_)
+  {
+    depths += bucket.load(std::memory_order_relaxed) != 0;
+  }
+  if (depths > 1)
+  {
+    out << "  by node depth (acquisitions, contended, mean contended wait):\n";
+    for (size_t i = 0; i < kDepthBuckets; ++i)
+    {
+      const uint64_t acquired = depth_acquisitions_[i].load(std::memory_order_relaxed);
+      if (acquired == 0)
+      {
+        continue;
+      }
+      const uint64_t contended = depth_contended_[i].load(std::memory_order_relaxed);
+      const uint64_t wait_ns = depth_wait_ns_[i].load(std::memory_order_relaxed);
+      out << "    depth " << BucketLower(i) << ".." << BucketUpper(i) << "\t" << acquired << '\t' << contended
+          << '\t' << (contended ? wait_ns / contended : 0) << "ns\n";
+    }
+  }
+  return out.str();
+}
+} // namespace job_manager
+} // namespace vm
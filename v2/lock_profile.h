@@ -0,0 +1,234 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Lock contention profiling.
+//
+// The lock sites of the ThreadSafeOrderedList and of CondVarWait take a Site policy. The
+// default NoLockSite leaves them plain std::unique_lock<std::mutex> acquisitions. With
+// LockSite, every acquisition through a ProfiledLock records how long it waited for the
+// mutex and how long it then held it into log2 histograms of the site. The list also records
+// each acquisition by the depth of the Node it locks, to show where in the list threads wait.
+//
+// The mutexes stay std::mutex, so condition_variable waits and the Clock policies are not
+// affected: the time a lock spends released inside a wait is simply not counted as held.
+//
+
+//
+// LatencyHistogram: log2 buckets of nanoseconds. Bucket i counts samples in [2^(i-1), 2^i).
+//
+class LatencyHistogram
+{
+public:
+  static constexpr size_t kBuckets = 40; // Up to ~9 minutes
+
+  void record(uint64_t nanoseconds)
+  {
+    const size_t bucket = nanoseconds == 0 ? 0 : std::min<size_t>(64 - __builtin_clzll(nanoseconds), kBuckets - 1);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const;
+  uint64_t total_ns() const { return total_ns_.load(std::memory_order_relaxed); }
+
+  //
+  // @brief: Upper bound (in ns) of the bucket holding the given quantile, 0 if empty.
+  //
+  uint64_t quantile(double quantile) const;
+
+  //
+  // @brief: One line per non-empty bucket: "  <lo>..<hi>ns  <count>  <bar>".
+  //
+  std::string format() const;
+
+private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t> total_ns_{0};
+};
+
+//
+// NoLockSite: profiling disabled. ProfiledLock<NoLockSite> is a plain unique_lock.
+//
+struct NoLockSite
+{
+  explicit NoLockSite(const char *) {}
+};
+
+//
+// LockSite: statistics of one lock site (ex. "list.insert").
+//
+class LockSite
+{
+public:
+  static constexpr size_t kDepthBuckets = 16; // log2 buckets of Node depth
+
+  explicit LockSite(const char *name) : name_(name) {}
+
+  LockSite(const LockSite &other) = delete;
+  LockSite &operator=(const LockSite &other) = delete;
+
+  void record_acquisition(uint64_t wait_ns, bool contended, size_t depth)
+  {
+    acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    wait_.record(wait_ns);
+    const size_t bucket = std::min<size_t>(depth == 0 ? 0 : 64 - __builtin_clzll(depth), kDepthBuckets - 1);
+    depth_acquisitions_[bucket].fetch_add(1, std::memory_order_relaxed);
+    if (contended)
+    {
+      contended_.fetch_add(1, std::memory_order_relaxed);
+      depth_contended_[bucket].fetch_add(1, std::memory_order_relaxed);
+      depth_wait_ns_[bucket].fetch_add(wait_ns, std::memory_order_relaxed);
+    }
+  }
+
+  void record_hold(uint64_t hold_ns)
+  {
+    hold_.record(hold_ns);
+  }
+
+  const char *name() const { return name_; }
+  uint64_t acquisitions() const { return acquisitions_.load(std::memory_order_relaxed); }
+  uint64_t contended() const { return contended_.load(std::memory_order_relaxed); }
+  const LatencyHistogram &wait() const { return wait_; }
+  const LatencyHistogram &hold() const { return hold_; }
+
+  //
+  // @brief: Human-readable report: counts, wait and hold histograms, and the contention by
+  //    Node depth when the site locks at more than one depth.
+  //
+  std::string format() const;
+
+private:
+  const char *name_;
+  std::atomic<uint64_t> acquisitions_{0};
+  std::atomic<uint64_t> contended_{0}; // Acquisitions that found the mutex taken
+  LatencyHistogram wait_; // Time to acquire
+  LatencyHistogram hold_; // Time held, up to unlock (or a condition_variable wait)
+  std::array<std::atomic<uint64_t>, kDepthBuckets> depth_acquisitions_{};
+  std::array<std::atomic<uint64_t>, kDepthBuckets> depth_contended_{};
+  std::array<std::atomic<uint64_t>, kDepthBuckets> depth_wait_ns_{};
+};
+
+//
+// ProfiledLock: std::unique_lock<std::mutex> that reports to a LockSite.
+//    released(f) runs f (a condition_variable wait on native()) without counting the time
+//    spent inside as held.
+//
+template <typename Site>
+class ProfiledLock
+{
+public:
+  ProfiledLock() = default;
+
+  ProfiledLock(std::mutex &mutex, Site &site, size_t depth = 0)
+    : site_(&site)
+  {
+    acquire(mutex, depth);
+  }
+
+  ProfiledLock(ProfiledLock &&other) noexcept
+    : lock_(std::move(other.lock_)), site_(other.site_), acquired_(other.acquired_)
+  {
+  }
+
+  ProfiledLock &operator=(ProfiledLock &&other) noexcept
+  {
+    if (this != &other)
+    {
+      release_hold();
+      lock_ = std::move(other.lock_);
+      site_ = other.site_;
+      acquired_ = other.acquired_;
+    }
+    return *this;
+  }
+
+  ~ProfiledLock()
+  {
+    release_hold();
+  }
+
+  void unlock()
+  {
+    release_hold();
+    lock_.unlock();
+  }
+
+  bool owns_lock() const { return lock_.owns_lock(); }
+
+  std::unique_lock<std::mutex> &native() { return lock_; }
+
+  template <typename F>
+  void released(F &&wait)
+  {
+    release_hold();
+    wait();
+    acquired_ = Task::clock_t::now();
+  }
+
+private:
+  void acquire(std::mutex &mutex, size_t depth)
+  {
+    lock_ = std::unique_lock<std::mutex>(mutex, std::try_to_lock);
+    if (lock_.owns_lock())
+    {
+      acquired_ = Task::clock_t::now();
+      site_->record_acquisition(0, false, depth);
+      return;
+    }
+    const Task::time_point_t start = Task::clock_t::now();
+    lock_.lock();
+    acquired_ = Task::clock_t::now();
+    site_->record_acquisition(std::chrono::duration_cast<std::chrono::nanoseconds>(acquired_ - start).count(), true, depth);
+  }
+
+  void release_hold()
+  {
+    if (lock_.owns_lock())
+    {
+      site_->record_hold(std::chrono::duration_cast<std::chrono::nanoseconds>(Task::clock_t::now() - acquired_).count());
+    }
+  }
+
+  std::unique_lock<std::mutex> lock_;
+  Site *site_{nullptr};
+  Task::time_point_t acquired_;
+};
+
+template <>
+class ProfiledLock<NoLockSite>
+{
+public:
+  ProfiledLock() = default;
+  ProfiledLock(std::mutex &mutex, NoLockSite &, size_t = 0) : lock_(mutex) {}
+
+  void unlock() { lock_.unlock(); }
+  bool owns_lock() const { return lock_.owns_lock(); }
+  std::unique_lock<std::mutex> &native() { return lock_; }
+
+  template <typename F>
+  void released(F &&wait)
+  {
+    wait();
+  }
+
+private:
+  std::unique_lock<std::mutex> lock_;
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,363 @@
+#include "job_manager.h"
+#include "shared_queue.h"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <csignal>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using vm::job_manager::BackgroundCheck;
+using vm::job_manager::BackgroundOptions;
+using vm::job_manager::BlockJobManager;
+using vm::job_manager::BucketJobManager;
+using vm::job_manager::CompactJobManager;
+using vm::job_manager::IndexRange;
+using vm::job_manager::JobManager;
+using vm::job_manager::ListJobManager;
+using vm::job_manager::SharedJob;
+using vm::job_manager::SharedJobConsumer;
+using vm::job_manager::SharedJobQueue;
+using vm::job_manager::VirtualClock;
+using vm::job_manager::VirtualJobManager;
+
+std::mutex cout_mutex;
+
+template <typename Manager>
+void create_random_order_tasks(Manager &tl, const std::vector<int>& t_list)
+{
+    std::vector<std::chrono::seconds> time_points{t_list.begin(), t_list.end()};
+
+    auto rng = std::default_random_engine {};
+    std::shuffle(std::begin(time_points), std::end(time_points), rng);
+
+    const auto start{std::chrono::steady_clock::now()};
+
+    for(auto tp: time_points){
+        std::thread([&tl, tp, start](){
+            tl.QueueJob(start + tp, [tp, start](){
+                const auto late = std::chrono::steady_clock::now() - (start + tp);
+                std::lock_guard<std::mutex> lock(cout_mutex);
+                std::cout << "Executed job scheduled at " << tp.count() << "s, "
+                          << std::chrono::duration_cast<std::chrono::milliseconds>(late).count()
+                          << "ms late" << std::endl;
+            });
+        }).detach();
+    }
+}
+
+template <typename Manager>
+void run(const std::string &trace)
+{
+    Manager scheduler;
+    if (!trace.empty())
+    {
+        scheduler.StartTrace(trace);
+    }
+
+    create_random_order_tasks(scheduler, {10, 20, 25, 30});
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    scheduler.Start();
+    create_random_order_tasks(scheduler, {-10, -20, 45});
+
+    std::this_thread::sleep_for(std::chrono::seconds(45));
+    scheduler.End();
+}
+
+//
+// Replay a day of randomly scheduled Jobs on the VirtualClock: no sleeping, so the run takes
+// the CPU time the scheduler needs to dispatch them, which is what gets reported.
+//
+void simulate()
+{
+    constexpr size_t kJobs = 100000;
+    const std::chrono::hours day(24);
+
+    // The clock must not move on while this thread is still queuing the day.
+    VirtualClock::Participant driver;
+    VirtualJobManager scheduler;
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int64_t> offset_ms(0, std::chrono::milliseconds(day).count());
+    std::atomic<size_t> executed{0};
+    std::atomic<int64_t> late_ns{0};
+    const auto start = VirtualClock::now();
+    for (size_t i = 0; i < kJobs; ++i)
+    {
+        const auto tp = start + std::chrono::milliseconds(offset_ms(rng));
+        scheduler.QueueJob(tp, [tp, &executed, &late_ns](){
+            late_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(VirtualClock::now() - tp).count();
+            ++executed;
+        });
+    }
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    const std::clock_t cpu_start = std::clock();
+    scheduler.Start();
+    VirtualClock::sleep_until(start + day + std::chrono::seconds(1));
+    scheduler.End();
+    const double cpu_s = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    const auto wall = std::chrono::steady_clock::now() - wall_start;
+
+    std::cout << "Executed " << executed << " jobs over 24h of virtual time in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(wall).count() << "ms wall, "
+              << (executed ? cpu_s * 1e6 / executed : 0.0) << "us CPU/job, "
+              << late_ns.load() << "ns total virtual lateness" << std::endl;
+}
+
+//
+// A compaction-style pass over 10M items scheduled for a point in time, once as a plain Job
+// on one worker and once as a QueueParallelFor spread over the 4 workers of the pool.
+//
+void parallel()
+{
+    constexpr size_t kItems = 10000000;
+    constexpr size_t kGrain = 16384;
+    std::vector<uint64_t> items(kItems);
+    const auto pass = [&items](size_t begin, size_t end){
+        for (size_t i = begin; i < end; ++i)
+        {
+            uint64_t item = items[i] + i;
+            for (int round = 0; round < 16; ++round)
+            {
+                item = item * 6364136223846793005ULL + 1442695040888963407ULL;
+            }
+            items[i] = item;
+        }
+    };
+
+    JobManager scheduler;
+    scheduler.Start();
+    for (const bool split : {false, true})
+    {
+        std::mutex mutex;
+        std::condition_variable done_cv;
+        bool done = false;
+        std::chrono::steady_clock::time_point finished;
+        const auto finish = [&](){
+            std::lock_guard<std::mutex> lock(mutex);
+            finished = std::chrono::steady_clock::now();
+            done = true;
+            done_cv.notify_one();
+        };
+
+        const auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        if (split)
+        {
+            scheduler.QueueParallelFor(start, IndexRange{0, kItems}, kGrain, pass, finish);
+        }
+        else
+        {
+            scheduler.QueueJob(start, [&](){ pass(0, kItems); finish(); });
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&done](){ return done; });
+        std::cout << (split ? "QueueParallelFor: " : "QueueJob:         ")
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(finished - start).count() << "ms on "
+                  << std::thread::hardware_concurrency() << " cores" << std::endl;
+    }
+    scheduler.End();
+}
+
+//
+// Two consumer processes share a queue the parent submits to. The first consumer is killed
+// half-way through a Job, which the survivor runs again once it has reaped the dead one.
+//
+void shared()
+{
+    const std::string name = "/vm_job_manager_demo";
+    SharedJobQueue::Unlink(name);
+    std::vector<pid_t> children;
+    {
+        SharedJobQueue queue(name, 1024);
+        for (int child = 0; child < 2; ++child)
+        {
+            const pid_t pid = fork();
+            if (pid == 0)
+            {
+                // Attach anew: the mapping is inherited, but not the keeper thread.
+                SharedJobQueue consumer_queue(name);
+                SharedJobConsumer consumer(consumer_queue, [child](const SharedJob &job){
+                    int seconds = 0;
+                    std::memcpy(&seconds, job.payload.data(), sizeof(seconds));
+                    {
+                        std::lock_guard<std::mutex> lock(cout_mutex);
+                        std::cout << "Process " << getpid() << " runs the job scheduled at " << seconds << "s"
+                                  << std::endl;
+                    }
+                    std::this_thread::sleep_for(std::chrono::seconds(child == 0 ? 3 : 0));
+                }, 1);
+                pause();
+                _exit(0);
+            }
+            children.push_back(pid);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int seconds : {1, 2, 3, 4, 5})
+        {
+            queue.Submit(start + std::chrono::seconds(seconds), 0, &seconds, sizeof(seconds));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        std::cout << "Killing process " << children[0] << std::endl;
+        kill(children[0], SIGKILL);
+        std::this_thread::sleep_for(std::chrono::seconds(6));
+        std::cout << queue.size() << " jobs left" << std::endl;
+    }
+    kill(children[1], SIGTERM);
+    for (pid_t child : children)
+    {
+        waitpid(child, nullptr, 0);
+    }
+    SharedJobQueue::Unlink(name);
+}
+
+//
+// A periodic 1ms timer next to 20 compaction passes of 20ms each: queued as plain Jobs due
+// now, then as background Jobs (200us horizon) that check ShouldYield every 100us of work.
+// Reports how late the timer Jobs start, and how much of the compaction got done meanwhile.
+//
+void background()
+{
+    constexpr int kTicks = 1000;
+    constexpr int kPasses = 20;
+    const auto tick = std::chrono::milliseconds(1);
+    const auto pass_length = std::chrono::milliseconds(20);
+    const auto chunk_length = std::chrono::microseconds(100);
+    const auto busy = [](std::chrono::nanoseconds length){
+        const auto until = std::chrono::steady_clock::now() + length;
+        while (std::chrono::steady_clock::now() < until)
+        {
+        }
+    };
+
+    for (const bool deferred : {false, true})
+    {
+        JobManager scheduler;
+        scheduler.SetBackground(BackgroundOptions{std::chrono::microseconds(200)});
+        scheduler.Start();
+
+        std::vector<int64_t> late_us(kTicks);
+        std::atomic<int> passes{0};
+        const auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        for (int i = 0; i < kTicks; ++i)
+        {
+            const auto tp = start + i * tick;
+            scheduler.QueueJob(tp, [tp, i, &late_us](){
+                late_us[i] = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - tp).count();
+            });
+        }
+        std::this_thread::sleep_until(start);
+        for (int i = 0; i < kPasses; ++i)
+        {
+            if (deferred)
+            {
+                auto left = std::make_shared<std::chrono::nanoseconds>(pass_length);
+                scheduler.QueueBackgroundJob([=, &passes](const BackgroundCheck &check){
+                    while (*left > std::chrono::nanoseconds::zero())
+                    {
+                        if (check.ShouldYield())
+                        {
+                            return false;
+                        }
+                        busy(chunk_length);
+                        *left -= chunk_length;
+                    }
+                    ++passes;
+                    return true;
+                });
+            }
+            else
+            {
+                scheduler.QueueJob(std::chrono::steady_clock::now(), [&](){
+                    busy(pass_length);
+                    ++passes;
+                });
+            }
+        }
+        std::this_thread::sleep_until(start + kTicks * tick + std::chrono::milliseconds(50));
+        const vm::job_manager::PoolSnapshot snapshot = scheduler.Snapshot();
+        scheduler.End();
+
+        std::sort(late_us.begin(), late_us.end());
+        std::cout << (deferred ? "QueueBackgroundJob: " : "QueueJob:           ")
+                  << "timer lateness p50 " << late_us[kTicks / 2] << "us, p99 " << late_us[kTicks * 99 / 100]
+                  << "us, max " << late_us.back() << "us; " << passes.load() << "/" << kPasses << " passes done";
+        if (deferred)
+        {
+            std::cout << ", " << snapshot.background_preempted << " yields";
+        }
+        std::cout << std::endl;
+    }
+}
+
+//
+// Usage: ./main [set|list|compact|block|bucket|virtual|shm|parallel|background] [trace-file]
+//    set     - Version-0 backend (default)
+//    list    - Version-1 backend
+//    compact - struct-of-arrays backend
+//    block   - bulk SIMD-scanned backend
+//    bucket  - same-deadline bucketing backend
+//    virtual - a day of Jobs replayed on the VirtualClock
+//    shm     - a queue shared by processes, one of them killed mid-Job
+//    parallel - a timed pass over 10M items, on one worker and with QueueParallelFor
+//    background - lateness of a periodic timer next to compaction Jobs, plain and background
+//    trace-file - record the queued Jobs into trace-file, for ./replay
+//
+int main(int argc, char *argv[])
+{
+    const std::string backend = argc > 1 ? argv[1] : "set";
+    const std::string trace = argc > 2 ? argv[2] : "";
+    if (backend == "list")
+    {
+        run<ListJobManager>(trace);
+    }
+    else if (backend == "compact")
+    {
+        run<CompactJobManager>(trace);
+    }
+    else if (backend == "block")
+    {
+        run<BlockJobManager>(trace);
+    }
+    else if (backend == "bucket")
+    {
+        run<BucketJobManager>(trace);
+    }
+    else if (backend == "virtual")
+    {
+        simulate();
+    }
+    else if (backend == "shm")
+    {
+        shared();
+    }
+    else if (backend == "parallel")
+    {
+        parallel();
+    }
+    else if (backend == "background")
+    {
+        background();
+    }
+    else
+    {
+        run<JobManager>(trace);
+    }
+
+    return 0;
+}
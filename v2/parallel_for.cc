@@ -0,0 +1,177 @@
+#include "parallel_for.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+//
+// Chunks [front, back) of a lane, packed as front << 32 | back.
+//
+struct alignas(64) Lane
+{
+  std::atomic<uint64_t> chunks{0};
+};
+
+uint64_t Pack(uint32_t front, uint32_t back)
+{
+  return static_cast<uint64_t>(front) << 32 | back;
+}
+
+uint32_t Front(uint64_t chunks)
+{
+  return static_cast<uint32_t>(chunks >> 32);
+}
+
+uint32_t Back(uint64_t chunks)
+{
+  return static_cast<uint32_t>(chunks);
+}
+
+struct State
+{
+  State(size_t participants, IndexRange range, size_t grain, size_t num_chunks,
+        ParallelFor::body_t &&body, ParallelFor::done_t &&done)
+    : range(range), grain(grain), lanes(participants), remaining(num_chunks),
+      body(std::move(body)), done(std::move(done))
+  {
+    for (size_t i = 0; i < participants; ++i)
+    {
+      lanes[i].chunks.store(Pack(static_cast<uint32_t>(i * num_chunks / participants),
+                                 static_cast<uint32_t>((i + 1) * num_chunks / participants)),
+                            std::memory_order_relaxed);
+    }
+  }
+
+  const IndexRange range;
+  const size_t grain;
+  std::vector<Lane> lanes;
+  std::atomic<size_t> next_lane{0}; // Lanes handed out to the participants so far
+  std::atomic<size_t> remaining; // Chunks that have not run yet
+  const ParallelFor::body_t body;
+  const ParallelFor::done_t done;
+};
+
+//
+// @brief: Take the first chunk of lane. Only its owner takes from the front.
+// @return: false if the lane is empty
+//
+bool TakeFront(Lane &lane, uint32_t &chunk)
+{
+  uint64_t chunks = lane.chunks.load(std::memory_order_acquire);
+  while (Front(chunks) < Back(chunks))
+  {
+    if (lane.chunks.compare_exchange_weak(chunks, Pack(Front(chunks) + 1, Back(chunks)), std::memory_order_acq_rel))
+    {
+      chunk = Front(chunks);
+      return true;
+    }
+  }
+  return false;
+}
+
+//
+// @brief: Move the back half of the fullest other lane into the (empty) lane of self.
+// @return: false if every lane is empty
+//
+bool Steal(State &state, size_t self)
+{
+  for (;;)
+  {
+    size_t victim = self;
+    uint32_t most = 0;
+    for (size_t i = 0; i < state.lanes.size(); ++i)
+    {
+      const uint64_t chunks = state.lanes[i].chunks.load(std::memory_order_relaxed);
+      const uint32_t size = Back(chunks) > Front(chunks) ? Back(chunks) - Front(chunks) : 0;
+      if (i != self && size > most)
+      {
+        victim = i;
+        most = size;
+      }
+    }
+    if (victim == self)
+    {
+      return false;
+    }
+
+    Lane &lane = state.lanes[victim];
+    uint64_t chunks = lane.chunks.load(std::memory_order_acquire);
+    while (Front(chunks) < Back(chunks))
+    {
+      // The back half, rounded down, but at least the one chunk left.
+      const uint32_t half = (Back(chunks) - Front(chunks)) / 2;
+      const uint32_t split = Back(chunks) - std::max<uint32_t>(half, 1);
+      if (lane.chunks.compare_exchange_weak(chunks, Pack(Front(chunks), split), std::memory_order_acq_rel))
+      {
+        // Nobody else adds to the lane of self, and it is empty: a plain store will do.
+        state.lanes[self].chunks.store(Pack(split, Back(chunks)), std::memory_order_release);
+        return true;
+      }
+    }
+  }
+}
+
+void Work(const std::shared_ptr<State> &state)
+{
+  const size_t self = state->next_lane.fetch_add(1, std::memory_order_relaxed);
+  if (self >= state->lanes.size())
+  {
+    return;
+  }
+  Lane &lane = state->lanes[self];
+  const IndexRange &range = state->range;
+  do
+  {
+    uint32_t chunk = 0;
+    while (TakeFront(lane, chunk))
+    {
+      const size_t begin = range.begin + chunk * state->grain;
+      state->body(begin, std::min(begin + state->grain, range.end));
+      if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && state->done)
+      {
+        state->done();
+      }
+    }
+  } while (Steal(*state, self));
+}
+} // namespace
+
+Task::task_t ParallelFor::Wrap(resubmit_t resubmit, size_t participants, IndexRange range, size_t grain,
+                               body_t body, done_t done)
+{
+  return [resubmit = std::move(resubmit), participants, range, grain, body = std::move(body),
+          done = std::move(done)]() mutable {
+    const size_t size = range.end > range.begin ? range.end - range.begin : 0;
+    size_t chunk_size = std::max<size_t>(grain, 1);
+    // Chunk indices are 32-bit: a range of more than 4G grains gets coarser chunks.
+    chunk_size = std::max(chunk_size, size / UINT32_MAX + 1);
+    const size_t num_chunks = (size + chunk_size - 1) / chunk_size;
+    if (num_chunks == 0)
+    {
+      if (done)
+      {
+        done();
+      }
+      return;
+    }
+
+    const size_t lanes = std::clamp<size_t>(participants, 1, num_chunks);
+    auto state = std::make_shared<State>(lanes, range, chunk_size, num_chunks, std::move(body), std::move(done));
+    for (size_t i = 1; i < lanes; ++i)
+    {
+      resubmit([state]() { Work(state); });
+    }
+    Work(state);
+  };
+}
+} // namespace job_manager
+} // namespace vm
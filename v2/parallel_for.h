@@ -0,0 +1,55 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <cstddef>
+#include <functional>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Half-open range of indices [begin, end).
+//
+struct IndexRange
+{
+  size_t begin{0};
+  size_t end{0};
+};
+
+//
+// ParallelFor: one timed Job that runs a range of indices on every worker of the Pool.
+//
+// The Job queued at the deadline is a launcher. When it runs, it cuts the range into chunks
+// of grain indices and deals them out in contiguous lanes, one lane per worker, then queues
+// a helper Job due now for every other lane and works on the first one itself. Every
+// participant takes the chunks of its lane from the front; once its lane is empty, it steals
+// the back half of the fullest lane of another participant and carries on with that. A helper
+// that starts late (its worker was busy) only finds its lane already stolen from, so the
+// range finishes as fast as the participants that did start can go.
+//
+// A lane is a pair of 32-bit chunk indices in a single atomic word: its owner takes one chunk
+// with a compare-exchange of the front, a thief takes the back half with a compare-exchange
+// of the back, and no lock is involved. The participant that finishes the last chunk runs the
+// completion callback, once.
+//
+class ParallelFor
+{
+public:
+  using body_t = std::function<void(size_t begin, size_t end)>; // Runs indices [begin, end)
+  using done_t = std::function<void(void)>;
+  using resubmit_t = std::function<void(Task::task_t &&)>;
+
+  //
+  // @brief: The launcher Job, to queue at the deadline.
+  // @param: resubmit queues a helper Job to run as soon as possible, on the same Pool.
+  // @param: participants is the number of lanes, the workers of the Pool.
+  // @param: grain is the number of indices per call of body (1 if 0).
+  // @param: done, if set, runs once after the last call of body has returned.
+  //
+  static Task::task_t Wrap(resubmit_t resubmit, size_t participants, IndexRange range, size_t grain,
+                           body_t body, done_t done);
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "lazy_list.h"
+#include "list.h"
+#include "time_point_task.h"
+
+#include <concepts>
+#include <memory>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Pending-Queue policies of the TaskPool.
+//
+// A Pending-Queue records the TimePointTasks that were added to the Pool but are not
+// executed yet, in the increasing order of their time_point. There are two families:
+//
+//  - OrderedPendingQueue: not thread-safe by itself. The Wait policy guards every access
+//    with its own lock, which also lets the workers peek the earliest time_point before
+//    deciding to sleep. (Version-0 std::set)
+//
+//    CompactQueue (compact_queue.h) is the struct-of-arrays variant of this family.
+//
+//  - ConcurrentPendingQueue: does its own (fine-grained) locking and can be used from
+//    several threads at once without any external lock. (Version-1 ThreadSafeOrderedList)
+//
+
+//
+// @brief: Requirements on a Pending-Queue that is guarded by an external lock
+//
+template <typename Q>
+concept OrderedPendingQueue = requires(Q &queue, const Q &const_queue, TimePointTask &&task) {
+  queue.insert(std::move(task));
+  { const_queue.empty() } -> std::convertible_to<bool>;
+  { const_queue.earliest() } -> std::convertible_to<Task::time_point_t>;
+  { queue.pop_front() } -> std::same_as<TimePointTask>;
+  queue.clear();
+};
+
+//
+// @brief: Requirements on a Pending-Queue that can hand out every due Task in one call.
+//    pop_until moves up to max_count Tasks whose time_point is <= now into out and returns
+//    how many it moved.
+//
+template <typename Q>
+concept BatchPendingQueue = requires(Q &queue, const Task::time_point_t &now,
+                                     std::vector<TimePointTask> &out, size_t max_count) {
+  { queue.pop_until(now, out, max_count) } -> std::convertible_to<size_t>;
+};
+
+//
+// @brief: Requirements on a Pending-Queue that synchronizes itself
+//
+template <typename Q>
+concept ConcurrentPendingQueue = requires(Q &queue, TimePointTask &&task) {
+  queue.insert(std::move(task));
+  { queue.pop() } -> std::same_as<std::unique_ptr<TimePointTask>>;
+  queue.clear();
+};
+
+//
+// @brief: Requirements on a ConcurrentPendingQueue that publishes its earliest time_point
+//    without locking. insert reports whether the Task became the earliest one.
+//
+template <typename Q>
+concept PeekablePendingQueue = ConcurrentPendingQueue<Q> && BatchPendingQueue<Q>
+  && requires(Q &queue, const Q &const_queue, TimePointTask &&task) {
+  { queue.insert(std::move(task)) } -> std::convertible_to<bool>;
+  { const_queue.peek_deadline() } -> std::convertible_to<std::optional<Task::time_point_t>>;
+};
+
+//
+// SetQueue: Version-0 ordered set of TimePointTasks. Every operation is O(log n) and needs the
+// external lock of the Wait policy.
+//
+// Version-0 used a std::set, which treats two Tasks with the same time_point as equal and
+// silently dropped every one but the first. A std::multiset keeps them all, in FIFO order.
+//
+class SetQueue
+{
+public:
+  void insert(TimePointTask &&task)
+  {
+    tasks_.insert(std::move(task));
+  }
+
+  bool empty() const
+  {
+    return tasks_.empty();
+  }
+
+  //
+  // @brief: time_point of the first Task in the set. The set must not be empty.
+  //
+  Task::time_point_t earliest() const
+  {
+    return tasks_.begin()->GetRunTimePoint();
+  }
+
+  //
+  // @brief: Remove and return the first Task of the set. The set must not be empty.
+  //
+  TimePointTask pop_front()
+  {
+    return std::move(tasks_.extract(tasks_.begin()).value()); // From C++17
+  }
+
+  //
+  // @brief: Move up to max_count Tasks that are due at now into out.
+  // @return: number of Tasks appended to out
+  //
+  template <typename Container>
+  size_t pop_until(const Task::time_point_t &now, Container &out, size_t max_count)
+  {
+    size_t count = 0;
+    auto it = tasks_.begin();
+    while (count < max_count && it != tasks_.end() && it->GetRunTimePoint() <= now)
+    {
+      out.emplace_back(std::move(tasks_.extract(it++).value()));
+      ++count;
+    }
+    return count;
+  }
+
+  void clear()
+  {
+    tasks_.clear();
+  }
+
+private:
+  std::multiset<TimePointTask> tasks_; // Tasks ordered by their time_point, FIFO among equals
+};
+
+//
+// OrderedListQueue: Version-1 hand-over-hand locked list. Used as-is, the list already
+// satisfies the ConcurrentPendingQueue requirements.
+//
+using OrderedListQueue = ThreadSafeOrderedList<TimePointTask>;
+
+//
+// LazyListQueue: the same List with lazy synchronization, inserts lock two Nodes instead of
+// every Node they walk past.
+//
+using LazyListQueue = LazyOrderedList<TimePointTask>;
+
+static_assert(OrderedPendingQueue<SetQueue>);
+static_assert(ConcurrentPendingQueue<OrderedListQueue>);
+static_assert(BatchPendingQueue<SetQueue>);
+static_assert(BatchPendingQueue<OrderedListQueue>);
+static_assert(PeekablePendingQueue<OrderedListQueue>);
+static_assert(PeekablePendingQueue<LazyListQueue>);
+} // namespace job_manager
+} // namespace vm
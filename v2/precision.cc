@@ -0,0 +1,162 @@
+#include "precision.h"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+//
+// @brief: Tell the core the thread is spinning: lets the sibling hyper-thread run, and saves
+//    power, without giving up the core.
+//
+inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+int64_t Nanoseconds(Task::clock_t::duration duration)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+thread_local bool designated_thread = false;
+} // namespace
+
+//
+// Calibration and statistics, shared by every designated thread of the process.
+//
+struct PrecisionClock::State
+{
+  std::atomic<int64_t> margin_ns{std::chrono::nanoseconds(kInitialMargin).count()};
+  std::atomic<uint64_t> spin_ns{0}; // Time spent spinning
+  LatencyHistogram overshoot;
+  LatencyHistogram lateness;
+};
+
+PrecisionClock::State &PrecisionClock::state()
+{
+  static State state;
+  return state;
+}
+
+bool PrecisionClock::designated()
+{
+  return designated_thread;
+}
+
+void PrecisionClock::designate()
+{
+  designated_thread = true;
+}
+
+void PrecisionClock::wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                                const Task::time_point_t &time_point)
+{
+  if (!designated())
+  {
+    cv.wait_until(lock, time_point);
+    return;
+  }
+  const Task::time_point_t wake_up = time_point - margin();
+  if (now() < wake_up)
+  {
+    if (cv.wait_until(lock, wake_up) == std::cv_status::no_timeout)
+    {
+      // Notified (or spurious): the caller re-checks, and waits again if nothing changed.
+      return;
+    }
+    calibrate(Nanoseconds(now() - wake_up));
+  }
+  // The producers must not be locked out of the queue for the spin.
+  lock.unlock();
+  spin_until(time_point);
+  lock.lock();
+}
+
+void PrecisionClock::sleep_until(const Task::time_point_t &time_point)
+{
+  if (!designated())
+  {
+    std::this_thread::sleep_until(time_point);
+    return;
+  }
+  const Task::time_point_t wake_up = time_point - margin();
+  if (now() < wake_up)
+  {
+    std::this_thread::sleep_until(wake_up);
+    calibrate(Nanoseconds(now() - wake_up));
+  }
+  spin_until(time_point);
+}
+
+std::chrono::nanoseconds PrecisionClock::margin()
+{
+  return std::chrono::nanoseconds(state().margin_ns.load(std::memory_order_relaxed));
+}
+
+const LatencyHistogram &PrecisionClock::overshoot()
+{
+  return state().overshoot;
+}
+
+const LatencyHistogram &PrecisionClock::lateness()
+{
+  return state().lateness;
+}
+
+//
+// Jump up to cover an overshoot with an eighth of slack (and 2us for the relock), decay by
+// 1/64 of the difference otherwise. The designated threads of several Pools may race on the
+// margin; whichever store wins is as good an estimate as the other.
+//
+void PrecisionClock::calibrate(int64_t overshoot_ns)
+{
+  State &clock = state();
+  clock.overshoot.record(static_cast<uint64_t>(std::max<int64_t>(overshoot_ns, 0)));
+  const int64_t target = overshoot_ns + overshoot_ns / 8 + 2000;
+  int64_t margin_ns = clock.margin_ns.load(std::memory_order_relaxed);
+  margin_ns = target > margin_ns ? target : margin_ns - (margin_ns - target) / 64;
+  margin_ns = std::clamp<int64_t>(margin_ns, std::chrono::nanoseconds(kMinMargin).count(),
+                                  std::chrono::nanoseconds(kMaxMargin).count());
+  clock.margin_ns.store(margin_ns, std::memory_order_relaxed);
+}
+
+void PrecisionClock::spin_until(const Task::time_point_t &time_point)
+{
+  const Task::time_point_t begin = now();
+  Task::time_point_t current = begin;
+  while (current < time_point)
+  {
+    CpuRelax();
+    current = now();
+  }
+  State &clock = state();
+  clock.spin_ns.fetch_add(Nanoseconds(current - begin), std::memory_order_relaxed);
+  clock.lateness.record(Nanoseconds(current - time_point));
+}
+
+std::string PrecisionClock::report()
+{
+  State &clock = state();
+  std::ostringstream out;
+  out << "precision: margin " << margin().count() << "ns, spun " << clock.spin_ns.load(std::memory_order_relaxed) / 1000
+      << "us, overshoot p50/p99 " << clock.overshoot.quantile(0.5) << '/' << clock.overshoot.quantile(0.99)
+      << "ns, lateness p50/p99 " << clock.lateness.quantile(0.5) << '/' << clock.lateness.quantile(0.99) << "ns\n";
+  out << "  overshoot:\n" << clock.overshoot.format();
+  out << "  lateness:\n" << clock.lateness.format();
+  return out.str();
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "clock.h"
+#include "lock_profile.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// PrecisionClock: real time, with hybrid sleep-then-spin waits on a designated worker.
+//
+// condition_variable::wait_until and sleep_until hand the wake-up to the kernel timer, which
+// fires 50-100us or more past the deadline under the default timer slack. A thread that
+// called designate() instead sleeps only until a margin before the deadline, then releases
+// the caller's lock and spins on steady_clock with a pause instruction until the deadline
+// itself. Every other thread waits exactly like on the SteadyClock, so only one core per Pool
+// spins, and only for the margin before each deadline.
+//
+// The margin calibrates itself: every sleep that ran into its wake-up time records how far
+// past it the thread actually woke up (the overshoot). The margin jumps up to any overshoot
+// it did not cover, plus slack, and decays towards the recent ones by 1/64 per sleep, so it
+// settles just above the tail of the overshoots of the machine.
+//
+// The overshoots and the lateness of the designated waits (how far past its deadline the
+// spin returned) are kept in histograms for the whole process (see report()).
+//
+// A spin does not see a notify: a Job inserted in front of the deadline during the spin is
+// only picked up by the designated worker once the spin is over, at most a margin later; the
+// other workers are notified as usual.
+//
+class PrecisionClock
+{
+public:
+  static constexpr std::chrono::microseconds kInitialMargin{100};
+  static constexpr std::chrono::microseconds kMinMargin{5};
+  static constexpr std::chrono::microseconds kMaxMargin{1000};
+
+  static Task::time_point_t now()
+  {
+    return Task::clock_t::now();
+  }
+
+  static void wait_until(std::condition_variable &cv, std::unique_lock<std::mutex> &lock,
+                         const Task::time_point_t &time_point);
+
+  static void wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock)
+  {
+    cv.wait(lock);
+  }
+
+  static void sleep_until(const Task::time_point_t &time_point);
+
+  static void add_participants(size_t) {}
+  static void remove_participant() {}
+
+  //
+  // @brief: Make the waits of the calling thread sleep-then-spin from now on. The TaskPool
+  //    calls it on worker 0.
+  //
+  static void designate();
+
+  //
+  // @brief: The current margin of the sleeps before a deadline.
+  //
+  static std::chrono::nanoseconds margin();
+
+  //
+  // @brief: How far past their wake-up time the sleeps of the designated threads ended.
+  //
+  static const LatencyHistogram &overshoot();
+
+  //
+  // @brief: How far past their deadline the waits of the designated threads returned.
+  //
+  static const LatencyHistogram &lateness();
+
+  //
+  // @brief: Human-readable report: the margin, the time spent spinning, and the overshoot
+  //    and lateness histograms with their p50/p99.
+  //
+  static std::string report();
+
+private:
+  struct State;
+
+  static State &state();
+  static bool designated();
+  static void calibrate(int64_t overshoot_ns);
+  static void spin_until(const Task::time_point_t &time_point);
+};
+
+static_assert(Clock<PrecisionClock>);
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,161 @@
+#include "realtime.h"
+
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+namespace vm
+{
+namespace job_manager
+{
+std::string RealtimeStatus::format() const
+{
+  std::ostringstream out;
+  out << "realtime: memory " << (future_locked ? "locked (current and future)" : memory_locked ? "locked (current)" : "not locked")
+      << ", " << fifo_workers << " SCHED_FIFO workers"
+      << ", queue mutex " << (priority_inheritance ? "priority-inheriting" : "plain") << '\n';
+  for (const std::string &line : degraded)
+  {
+    out << "  degraded: " << line << '\n';
+  }
+  return out.str();
+}
+
+void LockMemory(RealtimeStatus &status)
+{
+  rlimit limit{};
+  const bool unlimited = getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY;
+  if (unlimited && mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+  {
+    status.memory_locked = status.future_locked = true;
+    return;
+  }
+  if (mlockall(MCL_CURRENT) == 0)
+  {
+    status.memory_locked = true;
+    status.degraded.push_back("MCL_FUTURE skipped, RLIMIT_MEMLOCK is " + std::to_string(limit.rlim_cur) + " bytes");
+    return;
+  }
+  status.degraded.push_back(std::string("mlockall: ") + std::strerror(errno));
+}
+
+// Not inlined: the frame, and the alloca with it, is gone once it returns; the pages stay.
+__attribute__((noinline)) void PrefaultStack(size_t bytes)
+{
+  constexpr size_t kPage = 4096;
+  volatile unsigned char *stack = static_cast<unsigned char *>(alloca(bytes));
+  for (size_t offset = 0; offset < bytes; offset += kPage)
+  {
+    stack[offset] = 0;
+  }
+}
+
+bool PrepareRealtimeThread(int priority, std::string &error)
+{
+  // Real-time threads get no timer slack from the kernel anyway; the others ask for 1ns.
+  prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+  if (priority == 0)
+  {
+    return true;
+  }
+  sched_param param{};
+  param.sched_priority = std::clamp(priority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+  const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (result != 0)
+  {
+    error = "SCHED_FIFO " + std::to_string(param.sched_priority) + ": " + std::strerror(result);
+    return false;
+  }
+  return true;
+}
+
+CallableArena::CallableArena(size_t capacity)
+  : capacity_(std::min<size_t>(capacity, kNone - 1)),
+    slots_(std::make_unique<Slot[]>(capacity_)),
+    next_(std::make_unique<std::atomic<uint32_t>[]>(capacity_)),
+    head_(capacity_ == 0 ? kNone : 0)
+{
+  for (size_t i = 0; i < capacity_; ++i)
+  {
+    next_[i].store(i + 1 < capacity_ ? static_cast<uint32_t>(i + 1) : kNone, std::memory_order_relaxed);
+  }
+  // make_unique value-initialized the slots: every page is touched before the first Job.
+}
+
+CallableArena::~CallableArena()
+{
+  // Callables of the Jobs that were dropped instead of run.
+  for (size_t i = 0; i < capacity_; ++i)
+  {
+    if (slots_[i].destroy)
+    {
+      slots_[i].destroy(slots_[i].storage);
+    }
+  }
+}
+
+uint32_t CallableArena::Acquire()
+{
+  uint64_t head = head_.load(std::memory_order_acquire);
+  for (;;)
+  {
+    const uint32_t index = static_cast<uint32_t>(head);
+    if (index == kNone)
+    {
+      return kNone;
+    }
+    // next_[index] may be stale if the slot was taken and freed meanwhile; the tag changed
+    // then, and the exchange fails.
+    const uint64_t next = (((head >> 32) + 1) << 32) | next_[index].load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire))
+    {
+      used_.fetch_add(1, std::memory_order_relaxed);
+      return index;
+    }
+  }
+}
+
+void CallableArena::Release(uint32_t index)
+{
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  for (;;)
+  {
+    next_[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    const uint64_t next = (((head >> 32) + 1) << 32) | index;
+    if (head_.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed))
+    {
+      used_.fetch_sub(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+void CallableArena::Run(uint32_t index)
+{
+  Slot &slot = slots_[index];
+  // The slot is freed even if the callable throws.
+  struct Done
+  {
+    CallableArena *arena;
+    Slot &slot;
+    uint32_t index;
+
+    ~Done()
+    {
+      slot.destroy(slot.storage);
+      slot.destroy = nullptr;
+      arena->Release(index);
+    }
+  } done{this, slot, index};
+  slot.invoke(slot.storage);
+}
+} // namespace job_manager
+} // namespace vm
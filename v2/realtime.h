@@ -0,0 +1,167 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Real-time mode of a TaskPool.
+//
+// By default every AddJob allocates (the node of the Pending-Queue, and the std::function of
+// any callable that captures more than two pointers), and the AsyncExecutor starts a thread
+// per Job. None of that has a bounded latency. In real-time mode (TaskPool::SetRealtime):
+//  - the Pending-Queue is a FixedQueue (fixed_queue.h) preallocated for capacity Jobs,
+//  - the callables live in the slots of a CallableArena preallocated for capacity Jobs,
+//    and the queue only holds a 16-byte reference to their slot,
+//  - a full arena fails the submission (TryAddJob returns false, AddJob throws
+//    std::length_error) instead of allocating,
+//  - AddJob takes its std::function by r-value only (the copying AddJob throws
+//    std::logic_error); the std::function itself was built, and possibly allocated, by the
+//    caller. Only TryAddJob constructs the callable straight into the arena,
+//  - the memory of the process is locked (mlockall), the worker stacks prefaulted, the timer
+//    slack of the workers set to 1ns, and the workers optionally run under SCHED_FIFO,
+//  - the Pool runs options.workers workers, one by default: a single dispatcher. Every worker
+//    sleeps until the earliest deadline, so with several of them all wake up on it and queue
+//    up on the mutex, and the Job waits for whichever of them the scheduler picks first,
+//  - the queue mutex inherits priority (PTHREAD_PRIO_INHERIT) where the Wait policy supports
+//    it, so a SCHED_OTHER producer holding it runs at the priority of the SCHED_FIFO worker
+//    waiting for it instead of being preempted by the other workers.
+//
+// A setting that cannot be applied (no CAP_IPC_LOCK or CAP_SYS_NICE, a small
+// RLIMIT_MEMLOCK) is skipped and reported in RealtimeStatus; the Pool runs regardless. The
+// memory lock is process-wide and stays in place after EndProcessing.
+//
+struct RealtimeOptions
+{
+  size_t capacity{4096}; // Pending and running Jobs the Pool has storage for
+  size_t workers{1}; // Workers of the Pool, in place of the count it was built with
+  bool lock_memory{true}; // mlockall the process
+  size_t stack_prefault{256 * 1024}; // Bytes of every worker stack touched before its first Job
+  std::vector<int> priorities; // SCHED_FIFO priority of worker i (the last one for the rest), empty for SCHED_OTHER
+};
+
+//
+// What SetRealtime and the workers actually got.
+//
+struct RealtimeStatus
+{
+  bool memory_locked{false}; // Current mappings locked
+  bool future_locked{false}; // Future mappings locked too (MCL_FUTURE)
+  size_t fifo_workers{0}; // Workers running under SCHED_FIFO
+  bool priority_inheritance{false}; // The queue mutex is PTHREAD_PRIO_INHERIT
+  std::vector<std::string> degraded; // One line per setting that was skipped, and why
+
+  std::string format() const;
+};
+
+//
+// @brief: mlockall the process. MCL_FUTURE only when RLIMIT_MEMLOCK is unlimited, so that the
+//    later allocations of the process cannot start failing on the limit.
+//
+void LockMemory(RealtimeStatus &status);
+
+//
+// @brief: Touch bytes of the calling thread's stack, so its first Jobs do not page-fault.
+//
+void PrefaultStack(size_t bytes);
+
+//
+// @brief: Timer slack of 1ns for the calling thread, and SCHED_FIFO at priority (if not 0).
+//    Returns false, with the reason in error, if the scheduling policy could not be set.
+//
+bool PrepareRealtimeThread(int priority, std::string &error);
+
+//
+// CallableArena: fixed number of fixed-size slots for the callables of real-time Jobs.
+//
+// A callable is constructed in place in a free slot, and the Job queued for it is an
+// ArenaJob: a pointer and a slot index, small and trivially copyable enough for std::function
+// to store it without allocating. Running the ArenaJob runs the callable, destroys it and
+// frees the slot.
+//
+// Slots are handed out through a lock-free stack with an ABA tag, so producers and workers
+// never block each other on the arena. Callables larger than kSlotBytes do not compile.
+//
+class CallableArena
+{
+public:
+  static constexpr size_t kSlotBytes = 64;
+
+  explicit CallableArena(size_t capacity);
+  ~CallableArena();
+
+  CallableArena(const CallableArena &other) = delete;
+  CallableArena &operator=(const CallableArena &other) = delete;
+
+  //
+  // @brief: Move function into a free slot. Returns the ArenaJob that runs it, or an empty
+  //    task_t if every slot is taken.
+  //
+  template <typename F>
+  Task::task_t TryEmplace(F &&function)
+  {
+    using Callable = std::decay_t<F>;
+    static_assert(sizeof(Callable) <= kSlotBytes, "callable too large for a CallableArena slot");
+    static_assert(alignof(Callable) <= alignof(std::max_align_t), "callable over-aligned for a CallableArena slot");
+
+    const uint32_t index = Acquire();
+    if (index == kNone)
+    {
+      return Task::task_t();
+    }
+    Slot &slot = slots_[index];
+    new (slot.storage) Callable(std::forward<F>(function));
+    slot.invoke = [](void *storage) { (*std::launder(static_cast<Callable *>(storage)))(); };
+    slot.destroy = [](void *storage) { std::launder(static_cast<Callable *>(storage))->~Callable(); };
+    return ArenaJob{this, index};
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  //
+  // @brief: Slots taken.
+  //
+  size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  struct Slot
+  {
+    alignas(std::max_align_t) unsigned char storage[kSlotBytes];
+    void (*invoke)(void *storage){nullptr};
+    void (*destroy)(void *storage){nullptr}; // Set while the slot holds a callable
+  };
+
+  struct ArenaJob
+  {
+    CallableArena *arena;
+    uint32_t index;
+
+    void operator()() const { arena->Run(index); }
+  };
+
+  uint32_t Acquire();
+  void Release(uint32_t index);
+  void Run(uint32_t index);
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::unique_ptr<std::atomic<uint32_t>[]> next_; // Next free slot of every free slot, kNone at the bottom
+  std::atomic<uint64_t> head_; // Tag << 32 | first free slot
+  std::atomic<size_t> used_{0};
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,327 @@
+#include "task_pool.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using vm::job_manager::BlockTaskPool;
+using vm::job_manager::BucketTaskPool;
+using vm::job_manager::CompactTaskPool;
+using vm::job_manager::LazyListTaskPool;
+using vm::job_manager::ListTaskPool;
+using vm::job_manager::LockSite;
+using vm::job_manager::PreciseTaskPool;
+using vm::job_manager::PrecisionClock;
+using vm::job_manager::RealtimeOptions;
+using vm::job_manager::RealtimeTaskPool;
+using vm::job_manager::ProfiledLazyListTaskPool;
+using vm::job_manager::ProfiledListTaskPool;
+using vm::job_manager::ProfiledSetTaskPool;
+using vm::job_manager::SetTaskPool;
+using vm::job_manager::Task;
+using vm::job_manager::TimelineListTaskPool;
+using vm::job_manager::TimelineSetTaskPool;
+using vm::job_manager::TraceRecord;
+using vm::job_manager::TraceRecorder;
+
+namespace
+{
+using nanoseconds = std::chrono::nanoseconds;
+
+struct Report
+{
+  size_t jobs{0};
+  double seconds{0}; // Wall time from the first submission to the last completion
+  std::vector<int64_t> lateness_ns; // Sorted
+  std::string locks; // Lock site reports, profiled backends only, or the PrecisionClock or real-time report
+};
+
+//
+// SCHED_FIFO priority of the workers of the realtime backend, if the process may use it.
+//
+constexpr int kRealtimePriority = 10;
+
+//
+// Busy the worker for duration, the way the recorded Job did.
+//
+void Spin(nanoseconds duration)
+{
+  const Task::time_point_t until = Task::clock_t::now() + duration;
+  while (Task::clock_t::now() < until)
+  {
+  }
+}
+
+//
+// @brief: Replay trace on a fresh Pool with 4 workers (the JobManager default).
+//    Every submitting thread of the trace gets a thread of its own that queues its Jobs at
+//    the recorded times (scaled by 1/speed), so the concurrency of the producers is kept.
+//    The Jobs spin for their recorded duration and write down how late they started.
+//    With a timeline path, the execution timeline of the replay is written there.
+//
+template <typename Pool>
+Report Replay(const std::vector<TraceRecord> &trace, double speed, const std::string &timeline)
+{
+  std::map<uint32_t, std::vector<size_t>> submitters;
+  for (size_t i = 0; i < trace.size(); ++i)
+  {
+    submitters[trace[i].thread].push_back(i);
+  }
+  const int64_t base_ns = trace.front().submit_ns;
+  const auto scaled = [speed](int64_t ns) { return nanoseconds(static_cast<int64_t>(ns / speed)); };
+
+  Report report;
+  report.jobs = trace.size();
+  report.lateness_ns.assign(trace.size(), 0);
+  std::atomic<size_t> done{0};
+
+  Pool pool(4);
+  if constexpr (requires { pool.SetRealtime(RealtimeOptions{}); })
+  {
+    RealtimeOptions options;
+    options.capacity = trace.size();
+    options.workers = 4; // Like every other backend of the replay
+    options.priorities = {kRealtimePriority};
+    pool.SetRealtime(options);
+  }
+  pool.StartProcessingJobs();
+  if (!timeline.empty())
+  {
+    pool.StartTimeline();
+  }
+
+  const Task::time_point_t start = Task::clock_t::now() + std::chrono::milliseconds(10);
+  std::vector<std::thread> threads;
+  for (auto &[thread, jobs] : submitters)
+  {
+    threads.emplace_back([&, &jobs = jobs]() {
+      for (const size_t i : jobs)
+      {
+        const Task::time_point_t submit = start + scaled(trace[i].submit_ns - base_ns);
+        std::this_thread::sleep_until(submit);
+        const Task::time_point_t deadline = submit + scaled(trace[i].offset_ns);
+        const nanoseconds duration(trace[i].duration_ns);
+        // TryAddJob is AddJob but for the real-time Pool, which constructs the lambda in
+        // place instead of allocating a std::function; it has room for the whole trace.
+        pool.TryAddJob(deadline, [&, i, deadline, duration]() {
+          report.lateness_ns[i] = std::chrono::duration_cast<nanoseconds>(Task::clock_t::now() - deadline).count();
+          Spin(duration);
+          ++done;
+        });
+      }
+    });
+  }
+  for (std::thread &thread : threads)
+  {
+    thread.join();
+  }
+  while (done.load() < trace.size())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  report.seconds = std::chrono::duration<double>(Task::clock_t::now() - start).count();
+  if (!timeline.empty() && !pool.StopTimeline(timeline))
+  {
+    std::cerr << "Cannot write " << timeline << std::endl;
+  }
+  pool.EndProcessing();
+  for (const LockSite *site : pool.LockSites())
+  {
+    report.locks += site->format();
+  }
+  if constexpr (std::same_as<typename Pool::clock_type, PrecisionClock>)
+  {
+    report.locks += PrecisionClock::report();
+  }
+  if constexpr (requires { pool.SetRealtime(RealtimeOptions{}); })
+  {
+    report.locks += pool.Realtime().format();
+  }
+
+  std::sort(report.lateness_ns.begin(), report.lateness_ns.end());
+  return report;
+}
+
+double PercentileUs(const std::vector<int64_t> &sorted, double quantile)
+{
+  const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(quantile * sorted.size()));
+  return sorted[index] / 1e3;
+}
+
+void Print(const std::string &backend, const Report &report)
+{
+  std::printf("%-10s %8zu jobs %9.3fs %12.1f jobs/s  late(us) p50 %9.1f p90 %9.1f p99 %9.1f p99.9 %9.1f max %9.1f\n",
+              backend.c_str(), report.jobs, report.seconds, report.jobs / report.seconds,
+              PercentileUs(report.lateness_ns, 0.5), PercentileUs(report.lateness_ns, 0.9),
+              PercentileUs(report.lateness_ns, 0.99), PercentileUs(report.lateness_ns, 0.999),
+              report.lateness_ns.back() / 1e3);
+  std::fputs(report.locks.c_str(), stdout);
+}
+} // namespace
+
+//
+// Usage: ./replay <trace-file> [--speed <factor>] [--timeline <prefix>] [set|list|lazy|compact|block|bucket|precise|realtime|set-locks|list-locks|lazy-locks ...]
+//    Replays a trace recorded with JobManager::StartTrace on every backend given (all of
+//    them by default) and reports the throughput and the lateness percentiles of each.
+//    --speed compresses the submission times and deadlines, not the Job durations.
+//    lazy is the Version-1 list with lazy synchronization (lazy_list.h).
+//    precise is the Version-0 queue with sleep-then-spin dispatch (precision.h); it prints the
+//    calibrated margin and the overshoot and lateness histograms of the designated worker.
+//    realtime is the preallocated FixedQueue in real-time mode (realtime.h), SCHED_FIFO
+//    workers if permitted; it prints which real-time settings could not be applied.
+//    set-locks, list-locks and lazy-locks run set, list and lazy with lock profiling, and
+//    print the wait and hold histograms of every lock site after the results.
+//    --timeline writes the execution timeline of each backend to <prefix><backend>.json, for
+//    Perfetto; set and list then run with their contended lock waits in the timeline.
+//
+int main(int argc, char *argv[])
+{
+  const auto usage = [argv]() {
+    std::cerr << "Usage: " << argv[0] << " <trace-file> [--speed <factor>] [--timeline <prefix>] [set|list|lazy|compact|block|bucket|precise|realtime|set-locks|list-locks|lazy-locks ...]" << std::endl;
+    return 1;
+  };
+  if (argc < 2)
+  {
+    return usage();
+  }
+
+  std::vector<TraceRecord> trace;
+  try
+  {
+    trace = TraceRecorder::Load(argv[1]);
+  }
+  catch (const std::exception &error)
+  {
+    std::cerr << error.what() << std::endl;
+    return 1;
+  }
+  if (trace.empty())
+  {
+    std::cerr << argv[1] << " has no records" << std::endl;
+    return 1;
+  }
+  std::sort(trace.begin(), trace.end(),
+            [](const TraceRecord &a, const TraceRecord &b) { return a.submit_ns < b.submit_ns; });
+
+  double speed = 1.0;
+  std::string timeline;
+  std::vector<std::string> backends;
+  for (int i = 2; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--speed" && i + 1 < argc)
+    {
+      // The factor divides every offset of the trace: it has to be a finite number above 0.
+      const std::string factor = argv[++i];
+      size_t parsed = 0;
+      try
+      {
+        speed = std::stod(factor, &parsed);
+      }
+      catch (const std::exception &)
+      {
+        parsed = 0;
+      }
+      if (parsed == 0 || parsed != factor.size() || !std::isfinite(speed) || speed <= 0)
+      {
+        std::cerr << "--speed: " << factor << " is not a factor above 0" << std::endl;
+        return usage();
+      }
+    }
+    else if (arg == "--timeline" && i + 1 < argc)
+    {
+      timeline = argv[++i];
+    }
+    else
+    {
+      backends.push_back(arg);
+    }
+  }
+  // Scaled offsets must stay time_points: a tiny factor would overflow them.
+  double longest_ns = static_cast<double>(trace.back().submit_ns - trace.front().submit_ns);
+  for (const TraceRecord &record : trace)
+  {
+    longest_ns = std::max(longest_ns, std::abs(static_cast<double>(record.offset_ns)));
+  }
+  if (longest_ns / speed > 1e18)
+  {
+    std::cerr << "--speed: " << speed << " stretches the trace beyond the clock" << std::endl;
+    return usage();
+  }
+  if (backends.empty())
+  {
+    backends = {"set", "list", "lazy", "compact", "block", "bucket", "precise", "realtime"};
+  }
+
+  for (const std::string &backend : backends)
+  {
+    const std::string path = timeline.empty() ? timeline : timeline + backend + ".json";
+    if (backend == "set" && !path.empty())
+    {
+      Print(backend, Replay<TimelineSetTaskPool>(trace, speed, path));
+    }
+    else if (backend == "set")
+    {
+      Print(backend, Replay<SetTaskPool>(trace, speed, path));
+    }
+    else if (backend == "list" && !path.empty())
+    {
+      Print(backend, Replay<TimelineListTaskPool>(trace, speed, path));
+    }
+    else if (backend == "list")
+    {
+      Print(backend, Replay<ListTaskPool>(trace, speed, path));
+    }
+    else if (backend == "lazy")
+    {
+      Print(backend, Replay<LazyListTaskPool>(trace, speed, path));
+    }
+    else if (backend == "compact")
+    {
+      Print(backend, Replay<CompactTaskPool>(trace, speed, path));
+    }
+    else if (backend == "block")
+    {
+      Print(backend, Replay<BlockTaskPool>(trace, speed, path));
+    }
+    else if (backend == "bucket")
+    {
+      Print(backend, Replay<BucketTaskPool>(trace, speed, path));
+    }
+    else if (backend == "precise")
+    {
+      Print(backend, Replay<PreciseTaskPool>(trace, speed, path));
+    }
+    else if (backend == "realtime")
+    {
+      Print(backend, Replay<RealtimeTaskPool>(trace, speed, path));
+    }
+    else if (backend == "set-locks")
+    {
+      Print(backend, Replay<ProfiledSetTaskPool>(trace, speed, path));
+    }
+    else if (backend == "list-locks")
+    {
+      Print(backend, Replay<ProfiledListTaskPool>(trace, speed, path));
+    }
+    else if (backend == "lazy-locks")
+    {
+      Print(backend, Replay<ProfiledLazyListTaskPool>(trace, speed, path));
+    }
+    else
+    {
+      std::cerr << "Unknown backend " << backend << std::endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,539 @@
+#include "shared_queue.h"
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+constexpr uint32_t kMagic = 0x514a4d56; // "VMJQ"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNone = UINT32_MAX;
+
+enum SlotState : uint32_t
+{
+  kFree,
+  kQueued,
+  kRunning,
+};
+
+size_t Align(size_t offset)
+{
+  return (offset + 63) & ~size_t{63};
+}
+
+int64_t Nanoseconds(const Task::time_point_t &time_point)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count();
+}
+
+void FutexWait(std::atomic<uint32_t> &word, uint32_t expected, int64_t timeout_ns)
+{
+  const timespec timeout{static_cast<time_t>(timeout_ns / 1000000000), static_cast<long>(timeout_ns % 1000000000)};
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t> &word, int count)
+{
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+void InitRobustMutex(pthread_mutex_t *mutex)
+{
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+} // namespace
+
+struct SharedJobQueue::Slot
+{
+  int64_t deadline_ns;
+  uint64_t sequence; // Submission order, among equal deadlines
+  std::atomic<uint32_t> state; // SlotState, the only field recovery trusts: stored last, with release
+  uint32_t owner; // Process table entry of the taker, while kRunning
+  uint32_t type;
+  uint32_t size;
+  uint32_t generation; // Bumped on every Take, so a stale Done is ignored
+  uint32_t next_free;
+  char payload[kMaxPayload];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "slot states are shared between processes");
+
+struct SharedJobQueue::Header
+{
+  struct Process
+  {
+    pthread_mutex_t alive; // Held by the process for as long as it is attached
+    uint32_t in_use;
+    int32_t pid;
+  };
+
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint32_t> ready; // Set once the creator has initialized the segment
+  uint32_t capacity;
+  pthread_mutex_t mutex; // Guards everything below, and the slots
+  std::atomic<uint32_t> wake; // Futex word of the sleeping consumers, bumped on every wake-up
+  uint32_t size; // Slots in the heap
+  uint32_t free_head; // First free slot, kNone if full
+  uint64_t sequence;
+  int64_t last_reap_ns;
+  Process processes[kMaxProcesses];
+};
+
+SharedJobQueue::SharedJobQueue(const std::string &name, uint32_t capacity)
+  : name_(name)
+{
+  bool creator = true;
+  fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd_ < 0 && errno == EEXIST)
+  {
+    creator = false;
+    fd_ = shm_open(name.c_str(), O_RDWR, 0600);
+  }
+  if (fd_ < 0)
+  {
+    throw std::runtime_error("SharedJobQueue: cannot open " + name + ": " + std::strerror(errno));
+  }
+
+  if (creator)
+  {
+    const size_t heap_offset = Align(sizeof(Header));
+    const size_t slots_offset = Align(heap_offset + sizeof(uint32_t) * capacity);
+    length_ = slots_offset + sizeof(Slot) * capacity;
+    if (capacity == 0 || ftruncate(fd_, static_cast<off_t>(length_)) != 0)
+    {
+      close(fd_);
+      shm_unlink(name.c_str());
+      throw std::runtime_error("SharedJobQueue: cannot size " + name);
+    }
+  }
+  else
+  {
+    // The creator may not have sized the segment yet.
+    struct stat status{};
+    for (int attempt = 0; attempt < 5000 && fstat(fd_, &status) == 0 && status.st_size == 0; ++attempt)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    length_ = static_cast<size_t>(status.st_size);
+    if (length_ < sizeof(Header))
+    {
+      close(fd_);
+      throw std::runtime_error("SharedJobQueue: " + name + " is not initialized");
+    }
+  }
+
+  base_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (base_ == MAP_FAILED)
+  {
+    close(fd_);
+    throw std::runtime_error("SharedJobQueue: cannot map " + name);
+  }
+  header_ = static_cast<Header *>(base_);
+
+  if (creator)
+  {
+    header_->magic = kMagic;
+    header_->version = kVersion;
+    header_->capacity = capacity;
+    InitRobustMutex(&header_->mutex);
+    for (Header::Process &process : header_->processes)
+    {
+      InitRobustMutex(&process.alive);
+    }
+    slots_ = reinterpret_cast<Slot *>(static_cast<char *>(base_) + Align(Align(sizeof(Header)) + sizeof(uint32_t) * capacity));
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+      slots_[i].state.store(kFree, std::memory_order_relaxed);
+      slots_[i].next_free = i + 1 < capacity ? i + 1 : kNone;
+    }
+    header_->free_head = 0;
+    header_->ready.store(1, std::memory_order_release);
+  }
+  else
+  {
+    for (int attempt = 0; attempt < 5000 && header_->ready.load(std::memory_order_acquire) == 0; ++attempt)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const size_t expected = Align(Align(sizeof(Header)) + sizeof(uint32_t) * header_->capacity)
+                            + sizeof(Slot) * header_->capacity;
+    if (header_->ready.load(std::memory_order_acquire) == 0 || header_->magic != kMagic
+        || header_->version != kVersion || expected != length_)
+    {
+      munmap(base_, length_);
+      close(fd_);
+      throw std::runtime_error("SharedJobQueue: " + name + " is not a version 1 job queue");
+    }
+  }
+  heap_ = reinterpret_cast<uint32_t *>(static_cast<char *>(base_) + Align(sizeof(Header)));
+  slots_ = reinterpret_cast<Slot *>(static_cast<char *>(base_) + Align(Align(sizeof(Header)) + sizeof(uint32_t) * header_->capacity));
+
+  // Take an entry of the process table, reaping the dead ones first.
+  index_ = kNone;
+  Lock();
+  Reap(Nanoseconds(Task::clock_t::now()));
+  for (uint32_t i = 0; i < kMaxProcesses && index_ == kNone; ++i)
+  {
+    if (!header_->processes[i].in_use)
+    {
+      index_ = i;
+      header_->processes[i].in_use = 1;
+      header_->processes[i].pid = getpid();
+    }
+  }
+  Unlock();
+  if (index_ == kNone)
+  {
+    munmap(base_, length_);
+    close(fd_);
+    throw std::runtime_error("SharedJobQueue: " + name + " has no room for another process");
+  }
+
+  keeper_ = std::thread(&SharedJobQueue::Keep, this, index_);
+  std::unique_lock<std::mutex> lock(keeper_mutex_);
+  keeper_cv_.wait(lock, [this]() { return keeper_locked_; });
+}
+
+SharedJobQueue::~SharedJobQueue()
+{
+  Lock();
+  Requeue(index_);
+  header_->processes[index_].in_use = 0;
+  Unlock();
+  {
+    std::lock_guard<std::mutex> lock(keeper_mutex_);
+    detach_ = true;
+  }
+  keeper_cv_.notify_all();
+  keeper_.join();
+  munmap(base_, length_);
+  close(fd_);
+}
+
+bool SharedJobQueue::Unlink(const std::string &name)
+{
+  return shm_unlink(name.c_str()) == 0;
+}
+
+void SharedJobQueue::Keep(uint32_t index)
+{
+  pthread_mutex_t *alive = &header_->processes[index].alive;
+  if (pthread_mutex_lock(alive) == EOWNERDEAD)
+  {
+    // The previous owner of the entry died and was reaped already; nothing to repair.
+    pthread_mutex_consistent(alive);
+  }
+  std::unique_lock<std::mutex> lock(keeper_mutex_);
+  keeper_locked_ = true;
+  keeper_cv_.notify_all();
+  keeper_cv_.wait(lock, [this]() { return detach_; });
+  pthread_mutex_unlock(alive);
+}
+
+bool SharedJobQueue::Less(uint32_t a, uint32_t b) const
+{
+  const Slot &x = slots_[a];
+  const Slot &y = slots_[b];
+  return x.deadline_ns != y.deadline_ns ? x.deadline_ns < y.deadline_ns : x.sequence < y.sequence;
+}
+
+void SharedJobQueue::Lock() const
+{
+  const int result = pthread_mutex_lock(&header_->mutex);
+  if (result == EOWNERDEAD)
+  {
+    Repair();
+    pthread_mutex_consistent(&header_->mutex);
+  }
+  else if (result != 0)
+  {
+    throw std::runtime_error("SharedJobQueue: cannot lock " + name_ + ": " + std::strerror(result));
+  }
+}
+
+void SharedJobQueue::Unlock() const
+{
+  pthread_mutex_unlock(&header_->mutex);
+}
+
+void SharedJobQueue::Repair() const
+{
+  // A process died inside a critical section. Slot states are stored with release after
+  // the fields they vouch for, so the compiler cannot move them ahead of those: a kQueued
+  // slot has its deadline and payload. Rebuild the heap and the free list from them.
+  header_->size = 0;
+  header_->free_head = kNone;
+  for (uint32_t i = header_->capacity; i-- > 0;)
+  {
+    const uint32_t state = slots_[i].state.load(std::memory_order_acquire);
+    if (state == kQueued)
+    {
+      HeapPush(i);
+    }
+    else if (state == kFree)
+    {
+      slots_[i].next_free = header_->free_head;
+      header_->free_head = i;
+    }
+  }
+}
+
+void SharedJobQueue::HeapPush(uint32_t slot) const
+{
+  size_t hole = header_->size++;
+  while (hole > 0)
+  {
+    const size_t parent = (hole - 1) / 2;
+    if (!Less(slot, heap_[parent]))
+    {
+      break;
+    }
+    heap_[hole] = heap_[parent];
+    hole = parent;
+  }
+  heap_[hole] = slot;
+}
+
+uint32_t SharedJobQueue::HeapPop() const
+{
+  const uint32_t top = heap_[0];
+  const uint32_t last = heap_[--header_->size];
+  const size_t size = header_->size;
+  size_t hole = 0;
+  while (2 * hole + 1 < size)
+  {
+    size_t child = 2 * hole + 1;
+    if (child + 1 < size && Less(heap_[child + 1], heap_[child]))
+    {
+      ++child;
+    }
+    if (!Less(heap_[child], last))
+    {
+      break;
+    }
+    heap_[hole] = heap_[child];
+    hole = child;
+  }
+  if (size > 0)
+  {
+    heap_[hole] = last;
+  }
+  return top;
+}
+
+void SharedJobQueue::Requeue(uint32_t owner) const
+{
+  bool requeued = false;
+  for (uint32_t i = 0; i < header_->capacity; ++i)
+  {
+    if (slots_[i].state.load(std::memory_order_acquire) == kRunning && slots_[i].owner == owner)
+    {
+      slots_[i].state.store(kQueued, std::memory_order_release);
+      HeapPush(i);
+      requeued = true;
+    }
+  }
+  if (requeued)
+  {
+    header_->wake.fetch_add(1);
+    FutexWake(header_->wake, INT_MAX);
+  }
+}
+
+void SharedJobQueue::Reap(int64_t now_ns) const
+{
+  header_->last_reap_ns = now_ns;
+  for (uint32_t i = 0; i < kMaxProcesses; ++i)
+  {
+    Header::Process &process = header_->processes[i];
+    if (!process.in_use || i == index_)
+    {
+      continue;
+    }
+    const int result = pthread_mutex_trylock(&process.alive);
+    if (result == EOWNERDEAD)
+    {
+      Requeue(i);
+      process.in_use = 0;
+      pthread_mutex_consistent(&process.alive);
+      pthread_mutex_unlock(&process.alive);
+    }
+    else if (result == 0)
+    {
+      // Attached, but its keeper has not locked the entry yet.
+      pthread_mutex_unlock(&process.alive);
+    }
+  }
+}
+
+bool SharedJobQueue::Submit(const Task::time_point_t &time_to_run, uint32_t type, const void *payload, size_t size)
+{
+  if (size > kMaxPayload)
+  {
+    return false;
+  }
+  Lock();
+  const uint32_t index = header_->free_head;
+  if (index == kNone)
+  {
+    Unlock();
+    return false;
+  }
+  Slot &slot = slots_[index];
+  header_->free_head = slot.next_free;
+  slot.deadline_ns = Nanoseconds(time_to_run);
+  slot.sequence = header_->sequence++;
+  slot.type = type;
+  slot.size = static_cast<uint32_t>(size);
+  std::memcpy(slot.payload, payload, size);
+  slot.state.store(kQueued, std::memory_order_release);
+  HeapPush(index);
+  const bool earliest = heap_[0] == index;
+  if (earliest)
+  {
+    header_->wake.fetch_add(1);
+  }
+  Unlock();
+  if (earliest)
+  {
+    FutexWake(header_->wake, 1);
+  }
+  return true;
+}
+
+std::optional<SharedJob> SharedJobQueue::Take(const std::atomic_bool &stop)
+{
+  const int64_t reap_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(kReapInterval).count();
+  while (!stop.load())
+  {
+    const int64_t now = Nanoseconds(Task::clock_t::now());
+    Lock();
+    if (now - header_->last_reap_ns >= reap_ns)
+    {
+      Reap(now);
+    }
+    if (header_->size > 0 && slots_[heap_[0]].deadline_ns <= now)
+    {
+      const uint32_t index = HeapPop();
+      Slot &slot = slots_[index];
+      slot.owner = index_;
+      ++slot.generation;
+      slot.state.store(kRunning, std::memory_order_release);
+
+      SharedJob job;
+      job.time_to_run = Task::time_point_t(std::chrono::duration_cast<Task::time_point_t::duration>(
+        std::chrono::nanoseconds(slot.deadline_ns)));
+      job.type = slot.type;
+      job.size = slot.size;
+      std::memcpy(job.payload.data(), slot.payload, slot.size);
+      job.slot = index;
+      job.generation = slot.generation;
+
+      const bool more = header_->size > 0 && slots_[heap_[0]].deadline_ns <= now;
+      if (more)
+      {
+        header_->wake.fetch_add(1);
+      }
+      Unlock();
+      if (more)
+      {
+        FutexWake(header_->wake, 1);
+      }
+      return job;
+    }
+
+    // Sleep until the earliest deadline, a wake-up, or the next reap, whichever is first.
+    const uint32_t seen = header_->wake.load();
+    int64_t timeout = header_->last_reap_ns + reap_ns - now;
+    if (header_->size > 0)
+    {
+      timeout = std::min(timeout, slots_[heap_[0]].deadline_ns - now);
+    }
+    Unlock();
+    FutexWait(header_->wake, seen, std::max<int64_t>(timeout, 1));
+  }
+  return std::nullopt;
+}
+
+void SharedJobQueue::Done(const SharedJob &job)
+{
+  Lock();
+  Slot &slot = slots_[job.slot];
+  if (slot.state.load(std::memory_order_acquire) == kRunning && slot.owner == index_ && slot.generation == job.generation)
+  {
+    slot.state.store(kFree, std::memory_order_release);
+    slot.next_free = header_->free_head;
+    header_->free_head = job.slot;
+  }
+  Unlock();
+}
+
+void SharedJobQueue::WakeAll()
+{
+  header_->wake.fetch_add(1);
+  FutexWake(header_->wake, INT_MAX);
+}
+
+size_t SharedJobQueue::size() const
+{
+  Lock();
+  const size_t size = header_->size;
+  Unlock();
+  return size;
+}
+
+uint32_t SharedJobQueue::capacity() const
+{
+  return header_->capacity;
+}
+
+SharedJobConsumer::SharedJobConsumer(SharedJobQueue &queue, handler_t handler, size_t num_threads)
+  : queue_(queue), handler_(std::move(handler))
+{
+  threads_.reserve(num_threads);
+  for (size_t i = 0; i < num_threads; ++i)
+  {
+    threads_.emplace_back(&SharedJobConsumer::Run, this);
+  }
+}
+
+SharedJobConsumer::~SharedJobConsumer()
+{
+  stop_ = true;
+  queue_.WakeAll();
+  for (std::thread &thread : threads_)
+  {
+    thread.join();
+  }
+}
+
+void SharedJobConsumer::Run()
+{
+  while (std::optional<SharedJob> job = queue_.Take(stop_))
+  {
+    handler_(*job);
+    queue_.Done(*job);
+  }
+}
+} // namespace job_manager
+} // namespace vm
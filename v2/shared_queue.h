@@ -0,0 +1,176 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// SharedJobQueue: host-wide schedule of Jobs in POSIX shared memory, submitted to and
+// consumed from by any number of processes.
+//
+// A std::function cannot cross a process boundary, so the shared queue does not hold Tasks:
+// it holds fixed-size job descriptors (a type and up to kMaxPayload bytes of payload) that
+// the consuming process maps back to code, typically a switch on the type. Deadlines are
+// steady_clock time_points, which on Linux is CLOCK_MONOTONIC and the same in every process
+// of the host.
+//
+// The segment (shm_open + mmap) holds a header, a binary min-heap of slot indices ordered by
+// deadline and the slots themselves. Everything refers to the slots by index, never by
+// pointer, since every process maps the segment at a different address. One process-shared
+// robust mutex guards the heap; consumers sleep on a futex word in the segment until the
+// earliest deadline, and a producer wakes one of them (in whichever process) only when its
+// Job became the earliest one.
+//
+// Process crashes:
+//  - A process dying while holding the mutex leaves the heap half-updated. The next process
+//    to lock it gets EOWNERDEAD and rebuilds the heap and the free list from the state of
+//    every slot, which is the only thing a critical section commits to last.
+//  - Every attached process holds a robust mutex of its own in the process table for as long
+//    as it is attached. Consumers try those of the other processes every kReapInterval; a
+//    dead owner's mutex comes back EOWNERDEAD, and the Jobs it had taken but not finished
+//    are queued again. Delivery is therefore at-least-once.
+//
+struct SharedJob
+{
+  static constexpr size_t kMaxPayload = 88;
+
+  Task::time_point_t time_to_run;
+  uint32_t type{0};
+  uint32_t size{0}; // Bytes of payload in use
+  std::array<char, kMaxPayload> payload;
+  uint32_t slot{0}; // Where the job lives in the segment, for Done
+  uint32_t generation{0};
+};
+
+class SharedJobQueue
+{
+public:
+  static constexpr size_t kMaxPayload = SharedJob::kMaxPayload;
+  static constexpr size_t kMaxProcesses = 64;
+  static constexpr std::chrono::seconds kReapInterval{1};
+
+  //
+  // @brief: Open the queue called name ("/name", see shm_open), creating it with room for
+  //    capacity pending Jobs if it does not exist yet. An existing queue keeps its capacity.
+  //    Throws std::runtime_error if the segment cannot be created, mapped or attached to.
+  //
+  explicit SharedJobQueue(const std::string &name, uint32_t capacity = 65536);
+
+  //
+  // @brief: Detach. Jobs this process took and did not finish are queued again. The
+  //    segment itself stays, for the other processes, until Unlink.
+  //
+  ~SharedJobQueue();
+
+  SharedJobQueue(const SharedJobQueue &other) = delete;
+  SharedJobQueue &operator=(const SharedJobQueue &other) = delete;
+
+  //
+  // @brief: Remove the segment called name. Processes attached to it keep their mapping.
+  //
+  static bool Unlink(const std::string &name);
+
+  //
+  // @brief: Queue a Job of type with size bytes of payload, due at time_to_run. Returns false
+  //    if the queue is full or the payload is larger than kMaxPayload.
+  //
+  bool Submit(const Task::time_point_t &time_to_run, uint32_t type, const void *payload, size_t size);
+
+  //
+  // @brief: Block until a Job is due and take it, std::nullopt once stop is set (see
+  //    WakeAll). The Job counts as taken by this process until Done.
+  //
+  std::optional<SharedJob> Take(const std::atomic_bool &stop);
+
+  //
+  // @brief: Release the slot of a Job returned by Take, once it has run.
+  //
+  void Done(const SharedJob &job);
+
+  //
+  // @brief: Wake every consumer up, in every process, so that it re-checks its stop flag.
+  //
+  void WakeAll();
+
+  //
+  // @brief: Jobs queued and not taken yet.
+  //
+  size_t size() const;
+  uint32_t capacity() const;
+
+private:
+  struct Header;
+  struct Slot;
+
+  bool Less(uint32_t a, uint32_t b) const;
+  void Lock() const;
+  void Unlock() const;
+  void Repair() const;
+  void HeapPush(uint32_t slot) const;
+  uint32_t HeapPop() const;
+  void Requeue(uint32_t owner) const;
+  void Reap(int64_t now_ns) const;
+  void Keep(uint32_t index);
+
+  std::string name_;
+  int fd_{-1};
+  void *base_{nullptr};
+  size_t length_{0};
+  Header *header_{nullptr};
+  uint32_t *heap_{nullptr}; // capacity slot indices, the first size of them a min-heap
+  Slot *slots_{nullptr};
+  uint32_t index_{0}; // Entry of this process in the process table
+
+  // The robust mutex of the process table entry belongs to the thread that locked it, so a
+  // thread of its own holds it for as long as the queue is attached.
+  std::mutex keeper_mutex_;
+  std::condition_variable keeper_cv_;
+  bool keeper_locked_{false};
+  bool detach_{false};
+  std::thread keeper_;
+};
+
+//
+// SharedJobConsumer: num_threads threads of this process that take due Jobs out of a
+// SharedJobQueue and run handler on them.
+//
+class SharedJobConsumer
+{
+public:
+  using handler_t = std::function<void(const SharedJob &)>;
+
+  SharedJobConsumer(SharedJobQueue &queue, handler_t handler, size_t num_threads = 4);
+
+  //
+  // @brief: Stop taking Jobs and join the threads, after the Jobs they are running.
+  //
+  ~SharedJobConsumer();
+
+  SharedJobConsumer(const SharedJobConsumer &other) = delete;
+  SharedJobConsumer &operator=(const SharedJobConsumer &other) = delete;
+
+private:
+  void Run();
+
+  SharedJobQueue &queue_;
+  const handler_t handler_;
+  std::atomic_bool stop_{false};
+  std::vector<std::thread> threads_;
+};
+} // namespace job_manager
+} // namespace vm
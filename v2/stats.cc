@@ -0,0 +1,172 @@
+#include "stats.h"
+
+#include <cstdio>
+#include <sstream>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+std::atomic<uint32_t> next_thread_index{0};
+
+void Metric(std::ostringstream &out, const char *name, const char *type, const char *help)
+{
+  out << "# HELP job_manager_" << name << ' ' << help << '\n'
+      << "# TYPE job_manager_" << name << ' ' << type << '\n';
+}
+
+template <typename Value>
+void PerWorker(std::ostringstream &out, const PoolSnapshot &snapshot, const char *name,
+               const char *type, const char *help, Value WorkerSnapshot::*value, double scale = 1)
+{
+  Metric(out, name, type, help);
+  for (size_t i = 0; i < snapshot.workers.size(); ++i)
+  {
+    out << "job_manager_" << name << "{worker=\"" << i << "\"} "
+        << snapshot.workers[i].*value * scale << '\n';
+  }
+}
+} // namespace
+
+uint32_t ThreadIndex()
+{
+  thread_local const uint32_t index = next_thread_index++;
+  return index;
+}
+
+WorkerSnapshot PoolSnapshot::total() const
+{
+  WorkerSnapshot sum;
+  for (const WorkerSnapshot &worker : workers)
+  {
+    sum.dispatched += worker.dispatched;
+    sum.executed += worker.executed;
+    sum.inlined += worker.inlined;
+    sum.busy_ns += worker.busy_ns;
+    sum.idle_ns += worker.idle_ns;
+    sum.useful_wakeups += worker.useful_wakeups;
+    sum.spurious_wakeups += worker.spurious_wakeups;
+    sum.late_dropped += worker.late_dropped;
+    sum.coalesced += worker.coalesced;
+    sum.deprioritized += worker.deprioritized;
+  }
+  return sum;
+}
+
+double PoolSnapshot::utilization() const
+{
+  const WorkerSnapshot sum = total();
+  const uint64_t time = sum.busy_ns + sum.idle_ns;
+  return time ? static_cast<double>(sum.busy_ns) / time : 0.0;
+}
+
+WorkerSnapshot Read(const WorkerCounters &counters)
+{
+  WorkerSnapshot snapshot;
+  snapshot.dispatched = counters.dispatched.load(std::memory_order_relaxed);
+  snapshot.executed = counters.executed.load(std::memory_order_relaxed);
+  snapshot.inlined = counters.inlined.load(std::memory_order_relaxed);
+  snapshot.busy_ns = counters.busy_ns.load(std::memory_order_relaxed);
+  snapshot.idle_ns = counters.idle_ns.load(std::memory_order_relaxed);
+  snapshot.useful_wakeups = counters.useful_wakeups.load(std::memory_order_relaxed);
+  snapshot.spurious_wakeups = counters.spurious_wakeups.load(std::memory_order_relaxed);
+  snapshot.late_dropped = counters.late_dropped.load(std::memory_order_relaxed);
+  snapshot.coalesced = counters.coalesced.load(std::memory_order_relaxed);
+  snapshot.deprioritized = counters.deprioritized.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+std::string ToPrometheus(const PoolSnapshot &snapshot)
+{
+  std::ostringstream out;
+  Metric(out, "submitted_jobs_total", "counter", "Jobs added to the pool.");
+  out << "job_manager_submitted_jobs_total " << snapshot.submitted << '\n';
+  Metric(out, "pending_jobs", "gauge", "Jobs waiting in the pending queue.");
+  out << "job_manager_pending_jobs " << snapshot.pending << '\n';
+  Metric(out, "in_flight_jobs", "gauge", "Jobs taken out of the queue that have not returned yet.");
+  out << "job_manager_in_flight_jobs " << snapshot.in_flight << '\n';
+  Metric(out, "active_workers", "gauge", "Worker threads running.");
+  out << "job_manager_active_workers " << snapshot.active_workers << '\n';
+  Metric(out, "background_pending_jobs", "gauge", "Background jobs waiting to run.");
+  out << "job_manager_background_pending_jobs " << snapshot.background_pending << '\n';
+  Metric(out, "background_completed_jobs_total", "counter", "Background jobs that finished.");
+  out << "job_manager_background_completed_jobs_total " << snapshot.background_completed << '\n';
+  Metric(out, "background_preempted_total", "counter", "Times a background job yielded to timed work.");
+  out << "job_manager_background_preempted_total " << snapshot.background_preempted << '\n';
+  Metric(out, "utilization_ratio", "gauge", "Share of worker time spent running jobs.");
+  out << "job_manager_utilization_ratio " << snapshot.utilization() << '\n';
+
+  PerWorker(out, snapshot, "dispatched_jobs_total", "counter", "Jobs taken out of the queue.",
+            &WorkerSnapshot::dispatched);
+  PerWorker(out, snapshot, "executed_jobs_total", "counter", "Jobs the executor returned from.",
+            &WorkerSnapshot::executed);
+  PerWorker(out, snapshot, "inlined_jobs_total", "counter", "Jobs the worker ran itself instead of the executor.",
+            &WorkerSnapshot::inlined);
+  PerWorker(out, snapshot, "busy_seconds_total", "counter", "Time spent running jobs.",
+            &WorkerSnapshot::busy_ns, 1e-9);
+  PerWorker(out, snapshot, "idle_seconds_total", "counter", "Time spent waiting for due jobs.",
+            &WorkerSnapshot::idle_ns, 1e-9);
+  PerWorker(out, snapshot, "useful_wakeups_total", "counter", "Waits that returned at least one job.",
+            &WorkerSnapshot::useful_wakeups);
+  PerWorker(out, snapshot, "spurious_wakeups_total", "counter", "Waits that returned no job.",
+            &WorkerSnapshot::spurious_wakeups);
+  PerWorker(out, snapshot, "late_dropped_jobs_total", "counter", "Jobs dropped for being later than their budget.",
+            &WorkerSnapshot::late_dropped);
+  PerWorker(out, snapshot, "coalesced_jobs_total", "counter", "Jobs dropped for a later due job of their key.",
+            &WorkerSnapshot::coalesced);
+  PerWorker(out, snapshot, "deprioritized_jobs_total", "counter", "Late jobs queued again behind on-time work.",
+            &WorkerSnapshot::deprioritized);
+  return out.str();
+}
+
+MetricsDumper::MetricsDumper(std::string path, std::chrono::milliseconds interval,
+                             std::function<PoolSnapshot()> snapshot)
+  : path_(std::move(path)),
+    interval_(interval),
+    snapshot_(std::move(snapshot)),
+    thread_(&MetricsDumper::Run, this)
+{
+}
+
+MetricsDumper::~MetricsDumper()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+  Dump();
+}
+
+bool MetricsDumper::Dump() const
+{
+  const std::string text = ToPrometheus(snapshot_());
+  const std::string temporary = path_ + ".tmp";
+  std::FILE *file = std::fopen(temporary.c_str(), "w");
+  if (!file)
+  {
+    return false;
+  }
+  const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+  if (std::fclose(file) != 0 || !written)
+  {
+    return false;
+  }
+  return std::rename(temporary.c_str(), path_.c_str()) == 0;
+}
+
+void MetricsDumper::Run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!cv_.wait_for(lock, interval_, [this](){ return stop_; }))
+  {
+    lock.unlock();
+    Dump();
+    lock.lock();
+  }
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Runtime gauges of a TaskPool.
+//
+// The counters are always on, so the dispatch path only ever touches cache lines nobody else
+// writes to: every worker owns a cache-line aligned WorkerCounters that only it updates (a
+// relaxed load and store, no locked instruction), and the producers count submissions into
+// per-thread-index shards. Nothing is summed until somebody asks for a PoolSnapshot.
+//
+
+//
+// @brief: Small, stable index of the calling thread, handed out in first-call order.
+//
+uint32_t ThreadIndex();
+
+//
+// @brief: Add delta to a counter that only the calling thread writes.
+//
+inline void Bump(std::atomic<uint64_t> &counter, uint64_t delta = 1)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+//
+// Counters of one worker. Written by the worker only, read by Snapshot.
+//
+struct alignas(64) WorkerCounters
+{
+  std::atomic<uint64_t> dispatched{0}; // Jobs taken out of the Pending-Queue
+  std::atomic<uint64_t> executed{0}; // Jobs the Executor returned from
+  std::atomic<uint64_t> inlined{0}; // Of those, Jobs the worker ran itself (see cost_estimator.h)
+  std::atomic<uint64_t> busy_ns{0}; // Time spent handing Jobs to the Executor
+  std::atomic<uint64_t> idle_ns{0}; // Time spent waiting for due Jobs
+  std::atomic<uint64_t> useful_wakeups{0}; // Waits that returned at least one Job
+  std::atomic<uint64_t> spurious_wakeups{0}; // Waits that returned nothing
+  std::atomic<uint64_t> late_dropped{0}; // Jobs dropped by their DropAfter policy
+  std::atomic<uint64_t> coalesced{0}; // Jobs dropped by their Coalesce policy
+  std::atomic<uint64_t> deprioritized{0}; // Jobs queued again by their Deprioritize policy
+};
+
+//
+// Counter incremented from any thread, spread over cache-line aligned shards.
+//
+class ShardedCounter
+{
+public:
+  static constexpr size_t kShards = 16;
+
+  void add(uint64_t delta = 1)
+  {
+    shards_[ThreadIndex() % kShards].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  uint64_t load() const
+  {
+    uint64_t sum = 0;
+    for (const Shard &shard : shards_)
+    {
+      sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+private:
+  struct alignas(64) Shard
+  {
+    std::atomic<uint64_t> value{0};
+  };
+
+  std::array<Shard, kShards> shards_;
+};
+
+struct WorkerSnapshot
+{
+  uint64_t dispatched{0};
+  uint64_t executed{0};
+  uint64_t inlined{0};
+  uint64_t busy_ns{0};
+  uint64_t idle_ns{0};
+  uint64_t useful_wakeups{0};
+  uint64_t spurious_wakeups{0};
+  uint64_t late_dropped{0};
+  uint64_t coalesced{0};
+  uint64_t deprioritized{0};
+};
+
+//
+// Point-in-time view of a TaskPool. The counters are read one by one while the Pool keeps
+// running, so the derived gauges are approximate by a Job or two.
+//
+struct PoolSnapshot
+{
+  uint64_t submitted{0}; // Jobs added to the Pool
+  uint64_t pending{0}; // Jobs waiting in the Pending-Queue
+  uint64_t in_flight{0}; // Jobs taken out of the queue that have not returned yet
+  uint64_t active_workers{0}; // Workers running, between the minimum and the maximum if elastic
+  uint64_t background_pending{0}; // Background Jobs waiting for a runner (see background.h)
+  uint64_t background_completed{0}; // Background Jobs that finished
+  uint64_t background_preempted{0}; // Times a background Job yielded to timed work
+  std::vector<WorkerSnapshot> workers;
+
+  WorkerSnapshot total() const;
+
+  //
+  // @brief: Share of the workers' time spent running Jobs, in [0, 1].
+  //
+  double utilization() const;
+};
+
+WorkerSnapshot Read(const WorkerCounters &counters);
+
+//
+// @brief: The snapshot in Prometheus text exposition format. Every metric is prefixed with
+//    "job_manager_"; per-worker metrics carry a worker="<index>" label.
+//
+std::string ToPrometheus(const PoolSnapshot &snapshot);
+
+//
+// MetricsDumper: writes a snapshot to a file in Prometheus text format every interval, for
+// a node_exporter textfile collector or similar. The file is replaced atomically (written
+// next to it, then renamed), so a reader never sees a half-written dump.
+//
+class MetricsDumper
+{
+public:
+  MetricsDumper(std::string path, std::chrono::milliseconds interval,
+                std::function<PoolSnapshot()> snapshot);
+  ~MetricsDumper();
+
+  MetricsDumper(const MetricsDumper &other) = delete;
+  MetricsDumper &operator=(const MetricsDumper &other) = delete;
+
+  //
+  // @brief: Write a snapshot now. Returns false if the file could not be written.
+  //
+  bool Dump() const;
+
+private:
+  void Run();
+
+  const std::string path_;
+  const std::chrono::milliseconds interval_;
+  const std::function<PoolSnapshot()> snapshot_;
+  std::mutex mutex_; // Guards stop_
+  std::condition_variable cv_; // Signaled on stop
+  bool stop_{false};
+  std::thread thread_;
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,196 @@
+#include "strand.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+struct Later
+{
+  template <typename Node>
+  bool operator()(const Node *a, const Node *b) const
+  {
+    return a->time_point != b->time_point ? a->time_point > b->time_point : a->sequence > b->sequence;
+  }
+};
+} // namespace
+
+Strands::Strand::Strand(key_t key)
+  : key(key), head_(&stub_), tail_(&stub_)
+{
+}
+
+Strands::Strand::~Strand()
+{
+  // Only Jobs whose wake-ups were dropped by EndProcessing are left.
+  drain();
+  for (Node *node : ready_)
+  {
+    delete node;
+  }
+}
+
+void Strands::Strand::push(Node *node)
+{
+  node->next.store(nullptr, std::memory_order_relaxed);
+  Node *previous = head_.exchange(node, std::memory_order_acq_rel);
+  previous->next.store(node, std::memory_order_release);
+}
+
+bool Strands::Strand::wake()
+{
+  return credits_.fetch_add(1, std::memory_order_acq_rel) == 0;
+}
+
+Strands::Node *Strands::Strand::pop(bool &blocked)
+{
+  blocked = false;
+  Node *tail = tail_;
+  Node *next = tail->next.load(std::memory_order_acquire);
+  if (tail == &stub_)
+  {
+    if (!next)
+    {
+      blocked = head_.load(std::memory_order_acquire) != &stub_;
+      return nullptr;
+    }
+    tail_ = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next)
+  {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire))
+  {
+    blocked = true;
+    return nullptr;
+  }
+  // tail is the last Node: put the stub behind it, so that tail can be handed out.
+  push(&stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next)
+  {
+    tail_ = next;
+    return tail;
+  }
+  blocked = true;
+  return nullptr;
+}
+
+void Strands::Strand::drain()
+{
+  bool blocked = false;
+  do
+  {
+    while (Node *node = pop(blocked))
+    {
+      ready_.push_back(node);
+      std::push_heap(ready_.begin(), ready_.end(), Later());
+    }
+    if (blocked)
+    {
+      // A push is half-way through; the Nodes behind it may belong to a wake-up that came due.
+      std::this_thread::yield();
+    }
+  } while (blocked);
+}
+
+bool Strands::Strand::run(Strands &strands)
+{
+  for (size_t ran = 0; ran < kMaxTurn; ++ran)
+  {
+    drain();
+    // Every credit is a wake-up whose Job was pushed before the wake-up was queued, and that
+    // has not run yet: ready_ holds at least one Job per credit, and the earliest is due.
+    std::pop_heap(ready_.begin(), ready_.end(), Later());
+    std::unique_ptr<Node> node(ready_.back());
+    ready_.pop_back();
+    node->job();
+    node.reset();
+    strands.Finished(*this);
+    if (credits_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+Strands::Strands(resubmit_t resubmit)
+  : resubmit_(std::move(resubmit))
+{
+}
+
+Strands::~Strands() = default;
+
+Task::task_t Strands::Wrap(key_t key, const Task::time_point_t &time_to_run, Task::task_t &&job)
+{
+  std::shared_ptr<Strand> strand;
+  {
+    Shard &shard = ShardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::shared_ptr<Strand> &entry = shard.strands[key];
+    if (!entry)
+    {
+      entry = std::make_shared<Strand>(key);
+    }
+    entry->outstanding.fetch_add(1, std::memory_order_relaxed);
+    strand = entry;
+  }
+  Node *node = new Node;
+  node->time_point = time_to_run;
+  node->sequence = sequence_.fetch_add(1, std::memory_order_relaxed);
+  node->job = std::move(job);
+  strand->push(node);
+  return [this, strand = std::move(strand)]() {
+    if (strand->wake())
+    {
+      Turn(strand);
+    }
+  };
+}
+
+size_t Strands::size() const
+{
+  size_t count = 0;
+  for (const Shard &shard : shards_)
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    count += shard.strands.size();
+  }
+  return count;
+}
+
+void Strands::Turn(const std::shared_ptr<Strand> &strand)
+{
+  if (!strand->run(*this))
+  {
+    resubmit_([this, strand]() { Turn(strand); });
+  }
+}
+
+void Strands::Finished(Strand &strand)
+{
+  if (strand.outstanding.fetch_sub(1, std::memory_order_acq_rel) != 1)
+  {
+    return;
+  }
+  // Last Job of the strand: drop it, unless a Job was queued on it in the meantime.
+  Shard &shard = ShardOf(strand.key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto entry = shard.strands.find(strand.key);
+  if (entry != shard.strands.end() && entry->second.get() == &strand
+      && strand.outstanding.load(std::memory_order_relaxed) == 0)
+  {
+    shard.strands.erase(entry);
+  }
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "time_point_task.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Strands: serialized execution of the Jobs that share a key.
+//
+// QueueJob(key, ...) pushes the Job onto the lock-free queue of its strand (a Vyukov
+// intrusive MPSC list) right away, and queues a wake-up of the strand in the Pool at the
+// Job's time_point in its place. A wake-up that comes due while the strand is idle makes its
+// worker the runner of the strand; wake-ups that arrive while the strand runs only leave
+// a credit behind and return, so a strand occupies at most one worker at a time and Jobs
+// of the same key never run concurrently.
+//
+// The runner moves every queued Job into a heap ordered by time_point, and runs one Job,
+// the earliest, per wake-up credit. The Job of a wake-up that came due is in the heap, so
+// the earliest one is due as well: Jobs of a strand run in time_point order, without the
+// strand reading the clock, whichever worker their wake-ups came due on. After kMaxTurn Jobs
+// the runner hands the strand back to the Pool as a Job due now, so a busy strand cannot
+// keep a worker to itself.
+//
+// The strands of the keys are created on demand and dropped with their last Job. Finding
+// the strand of a key takes a sharded mutex, once per QueueJob and once per idle strand.
+//
+class Strands
+{
+public:
+  using key_t = uint64_t;
+  using resubmit_t = std::function<void(Task::task_t &&)>;
+
+  static constexpr size_t kShards = 16;
+  static constexpr size_t kMaxTurn = 64; // Jobs a runner runs before giving the worker back
+
+  //
+  // @param: resubmit queues a Job to run as soon as possible, on the Pool the strand Jobs
+  //    are queued on.
+  //
+  explicit Strands(resubmit_t resubmit);
+  ~Strands();
+
+  Strands(const Strands &other) = delete;
+  Strands &operator=(const Strands &other) = delete;
+
+  //
+  // @brief: Queue job on the strand of key. Returns the wake-up to queue in the Pool in its
+  //    place, due at time_to_run.
+  //
+  Task::task_t Wrap(key_t key, const Task::time_point_t &time_to_run, Task::task_t &&job);
+
+  //
+  // @brief: Strands with Jobs that have not run yet.
+  //
+  size_t size() const;
+
+private:
+  struct Node
+  {
+    std::atomic<Node *> next{nullptr};
+    Task::time_point_t time_point;
+    uint64_t sequence{0}; // Submission order, among equal time_points
+    Task::task_t job;
+  };
+
+  class Strand
+  {
+  public:
+    explicit Strand(key_t key);
+    ~Strand();
+
+    //
+    // @brief: Any thread. Queue node, it runs on a later wake-up.
+    //
+    void push(Node *node);
+
+    //
+    // @brief: Any thread. Returns true if the strand was idle: the caller is now its runner.
+    //
+    bool wake();
+
+    //
+    // @brief: Runner only. Run a Job per wake-up credit until none is left (true), or until
+    //    kMaxTurn Jobs have run (false: the caller must hand the strand over to another turn).
+    //
+    bool run(Strands &strands);
+
+    const key_t key;
+    std::atomic<size_t> outstanding{0}; // Jobs queued on the strand that have not run yet
+
+  private:
+    //
+    // @brief: Move every Node whose push has completed into ready_.
+    //
+    void drain();
+
+    //
+    // @brief: The Node at the tail, nullptr if the queue is empty. Sets blocked if a push is
+    //    half-way through: the queue is not empty, but its next Node is not linked in yet.
+    //
+    Node *pop(bool &blocked);
+
+    std::atomic<Node *> head_; // Last pushed Node, producers
+    Node *tail_; // Next Node to pop, runner
+    Node stub_;
+    std::atomic<size_t> credits_{0}; // Wake-ups that came due and have not run a Job yet
+    std::vector<Node *> ready_; // Popped Nodes, min-heap on the time_point, runner
+  };
+
+  struct alignas(64) Shard
+  {
+    mutable std::mutex mutex; // Guards strands
+    std::unordered_map<key_t, std::shared_ptr<Strand>> strands;
+  };
+
+  void Turn(const std::shared_ptr<Strand> &strand);
+  void Finished(Strand &strand);
+  Shard &ShardOf(key_t key) { return shards_[key % kShards]; }
+
+  const resubmit_t resubmit_;
+  std::atomic<uint64_t> sequence_{0};
+  std::array<Shard, kShards> shards_;
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,1071 @@
+#pragma once
+
+#include "background.h"
+#include "block_queue.h"
+#include "bucket_queue.h"
+#include "clock.h"
+#include "compact_queue.h"
+#include "cost_estimator.h"
+#include "elastic.h"
+#include "executor.h"
+#include "fixed_queue.h"
+#include "lateness.h"
+#include "lock_profile.h"
+#include "pending_queue.h"
+#include "precision.h"
+#include "realtime.h"
+#include "stats.h"
+#include "time_point_task.h"
+#include "timeline.h"
+#include "wait_policy.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <optional>
+#include <concepts>
+#include <stdexcept>
+#include <string>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// TaskPool Class to contain the threads and the list of tasks
+//
+// Version-2 builds the Pool out of three compile-time policies instead of hard-coding them:
+//  - Queue:    where the pending Tasks are recorded (pending_queue.h)
+//  - Wait:     how producers and workers synchronize on the Queue (wait_policy.h)
+//  - Executor: how a Task taken out of the Queue is run (executor.h)
+//
+// The Wait and Executor policies are both instantiated with the same Clock (clock.h), which
+// is where the Pool reads the time from: real time, or a VirtualClock for simulations.
+//
+// Every combination is resolved at compile time; there is no virtual call between the
+// worker loop and the policies, the compiler sees (and can inline) all of it.
+//
+template <typename Queue, typename Wait, Executor Exec>
+  requires WaitPolicy<Wait, Queue> && std::same_as<typename Wait::clock_type, typename Exec::clock_type>
+class TaskPool
+{
+public:
+  using queue_type = Queue;
+  using wait_type = Wait;
+  using executor_type = Exec;
+  using clock_type = typename Wait::clock_type;
+
+  //
+  // @brief: Constructor to build the task_list
+  // @param: num_threads is the number of threads available in the Pool to complete the Jobs
+  //
+  explicit TaskPool(int num_threads)
+    : num_threads_(num_threads),
+      max_threads_(num_threads),
+      workers_(std::make_unique<Worker[]>(max_threads_)),
+      counters_(std::make_unique<WorkerCounters[]>(max_threads_))
+  {
+  }
+
+  ~TaskPool()
+  {
+    EndProcessing();
+  }
+
+  TaskPool(const TaskPool &other) = delete;
+  TaskPool &operator=(const TaskPool &other) = delete;
+
+  //
+  // @brief: AddJob will add the tasks to the list
+  //    based on the DataStructure used to hold the tasks, the task might be ordered
+  //    Not in real-time mode, where copying function may allocate: it throws
+  //    std::logic_error there, use the r-value AddJob or TryAddJob.
+  // @param: time_point: const-reference to steady_time::time_point type
+  // @param: task: const-reference to function<void()> type
+  //
+  void AddJob(const Task::time_point_t &time_to_run, const Task::task_t &function)
+  {
+    if (arena_)
+    {
+      throw std::logic_error("TaskPool: copying AddJob in real-time mode");
+    }
+    submitted_.add();
+    if (timeline_.enabled())
+    {
+      return AddTimedJob(time_to_run, Task::task_t(function));
+    }
+    Push(TimePointTask(time_to_run, function));
+  }
+
+  //
+  // @brief: AddJob will add the tasks to the list
+  //    based on the DataStructure used to hold the tasks, the task might be ordered
+  // @param: time_point: r-value-reference to steady_time::time_point type
+  // @param: task: r-value-reference to function<void()> type
+  //
+  void AddJob(Task::time_point_t &&time_to_run, Task::task_t &&function)
+  {
+    if (arena_)
+    {
+      return AddRealtimeJob(time_to_run, std::move(function));
+    }
+    submitted_.add();
+    if (timeline_.enabled())
+    {
+      return AddTimedJob(time_to_run, std::move(function));
+    }
+    Push(TimePointTask(std::move(time_to_run), std::move(function)));
+  }
+
+  //
+  // @brief: AddJob with a policy for when the Job comes out of the queue late (see
+  //    lateness.h). LatenessPolicy::Always() is the plain AddJob.
+  //
+  void AddJob(const Task::time_point_t &time_to_run, Task::task_t &&function, const LatenessPolicy &policy)
+  {
+    if (policy.action == LatenessPolicy::Action::kRun)
+    {
+      return AddJob(Task::time_point_t(time_to_run), std::move(function));
+    }
+    if (arena_)
+    {
+      throw std::logic_error("TaskPool: no LatenessPolicy in real-time mode");
+    }
+    submitted_.add();
+    lateness_.store(true, std::memory_order_relaxed);
+    if (timeline_.enabled())
+    {
+      return AddTimedJob(time_to_run, std::move(function), policy);
+    }
+    Push(TimePointTask(time_to_run, Wrap(time_to_run, std::move(function), policy)));
+  }
+
+  //
+  // @brief: AddJob with a hint on where to run the Job (see cost_estimator.h).
+  //    ExecutionHint::kAuto is the plain AddJob.
+  //
+  void AddJob(const Task::time_point_t &time_to_run, Task::task_t &&function, ExecutionHint hint)
+  {
+    if (hint == ExecutionHint::kAuto)
+    {
+      return AddJob(Task::time_point_t(time_to_run), std::move(function));
+    }
+    if (arena_)
+    {
+      throw std::logic_error("TaskPool: no ExecutionHint in real-time mode");
+    }
+    submitted_.add();
+    hints_.store(true, std::memory_order_relaxed);
+    if (timeline_.enabled())
+    {
+      return AddTimedJob(time_to_run, std::move(function), LatenessPolicy::Always(), hint);
+    }
+    Push(TimePointTask(time_to_run, Wrap(time_to_run, std::move(function), LatenessPolicy::Always(), hint)));
+  }
+
+  //
+  // @brief: AddJob that never allocates in real-time mode (see realtime.h): function is
+  //    constructed straight into a slot of the CallableArena. Returns false, and queues
+  //    nothing, if every slot is taken. Outside of real-time mode it is the plain AddJob.
+  //
+  template <typename F>
+  bool TryAddJob(const Task::time_point_t &time_to_run, F &&function)
+  {
+    if (!arena_)
+    {
+      AddJob(Task::time_point_t(time_to_run), Task::task_t(std::forward<F>(function)));
+      return true;
+    }
+    Task::task_t job = arena_->TryEmplace(std::forward<F>(function));
+    if (!job)
+    {
+      return false;
+    }
+    submitted_.add();
+    Push(TimePointTask(time_to_run, std::move(job)));
+    return true;
+  }
+
+  //
+  // @brief: Queue a background Job (see background.h): it runs once no timed Job is due
+  //    within the horizon, and yields at its next ShouldYield() when one comes up. Not in
+  //    real-time mode, where it throws std::logic_error.
+  //
+  void AddBackgroundJob(BackgroundJob &&job)
+    requires requires(Wait &wait, Queue &queue) { wait.next_deadline(queue); }
+  {
+    if (arena_)
+    {
+      throw std::logic_error("TaskPool: no background Jobs in real-time mode");
+    }
+    background_used_.store(true);
+    if (background_.Push(std::move(job)))
+    {
+      PushRunner(clock_type::now());
+    }
+  }
+
+  //
+  // @brief: Horizon of the background Jobs. Call it before the first AddBackgroundJob.
+  //
+  void SetBackground(const BackgroundOptions &options)
+  {
+    background_options_ = options;
+    background_options_.horizon = std::max(options.horizon, std::chrono::microseconds(1));
+  }
+
+  //
+  // @brief: Estimate the duration of every kind of Job from now on, and run the Jobs of
+  //    kinds that take cheap or less on the workers. Zero stops estimating. Only the Pools
+  //    with an Executor that hands Jobs off to other threads run Jobs inline.
+  //
+  void EnableCostEstimator(std::chrono::nanoseconds cheap)
+  {
+    cheap_ns_.store(cheap.count(), std::memory_order_relaxed);
+  }
+
+  //
+  // @brief: Time a worker may spend running Jobs inline per wake-up, before it hands the
+  //    rest of its Jobs to the Executor.
+  //
+  void SetInlineBudget(std::chrono::nanoseconds budget)
+  {
+    inline_budget_ns_.store(budget.count(), std::memory_order_relaxed);
+  }
+
+  //
+  // @brief: StartProcessingJobs to start the reserved number of threads in the pool
+  //    The workers count as participants of the Clock from here on, before they even run, so
+  //    a VirtualClock cannot skip ahead of Jobs the workers have not looked at yet.
+  //
+  void StartProcessingJobs()
+  {
+    clock_type::add_participants(num_threads_);
+    for (size_t i = 0; i < num_threads_; i++)
+    {
+      Spawn(i);
+    }
+    if (arena_ && realtime_.lock_memory)
+    {
+      // After the Spawns: the worker stacks are part of what gets locked.
+      std::lock_guard<std::mutex> lock(realtime_mutex_);
+      LockMemory(realtime_status_);
+    }
+    if (max_threads_ > num_threads_)
+    {
+      supervisor_ = std::thread(&TaskPool::Supervise, this);
+    }
+  }
+
+  //
+  // @brief: Size the Pool between options.min_workers and options.max_workers from now on
+  //    (see elastic.h) instead of num_threads. Call it before StartProcessingJobs.
+  //
+  void SetElastic(const ElasticOptions &options)
+  {
+    elastic_ = options;
+    num_threads_ = std::max<size_t>(options.min_workers, 1);
+    max_threads_ = std::max(options.max_workers, num_threads_);
+    workers_ = std::make_unique<Worker[]>(max_threads_);
+    counters_ = std::make_unique<WorkerCounters[]>(max_threads_);
+  }
+
+  //
+  // @brief: Run the Pool in real-time mode (see realtime.h): preallocate the queue and a
+  //    CallableArena for options.capacity Jobs, size the Pool to options.workers, make the
+  //    queue mutex priority-inheriting, and lock the memory and set up the workers on
+  //    StartProcessingJobs. Call it before StartProcessingJobs, on a Pool whose queue has
+  //    fixed storage (FixedQueue). The AddJob overloads with a LatenessPolicy or an
+  //    ExecutionHint wrap their Job into an allocated function object, and throw
+  //    std::logic_error in real-time mode.
+  //
+  void SetRealtime(const RealtimeOptions &options)
+    requires requires(Queue &queue) { queue.reserve(size_t{}); queue.capacity(); }
+  {
+    realtime_ = options;
+    queue_.reserve(options.capacity);
+    arena_ = std::make_unique<CallableArena>(options.capacity);
+    num_threads_ = max_threads_ = std::max<size_t>(options.workers, 1);
+    workers_ = std::make_unique<Worker[]>(max_threads_);
+    counters_ = std::make_unique<WorkerCounters[]>(max_threads_);
+
+    std::lock_guard<std::mutex> lock(realtime_mutex_);
+    if constexpr (requires { wait_.inherit_priority(); })
+    {
+      realtime_status_.priority_inheritance = wait_.inherit_priority();
+    }
+    if (!realtime_status_.priority_inheritance)
+    {
+      realtime_status_.degraded.push_back("queue mutex: no priority inheritance");
+    }
+  }
+
+  //
+  // @brief: What the real-time mode got: memory locking, SCHED_FIFO workers, and every
+  //    setting that was skipped for lack of permission.
+  //
+  RealtimeStatus Realtime() const
+  {
+    std::lock_guard<std::mutex> lock(realtime_mutex_);
+    return realtime_status_;
+  }
+
+  //
+  // @brief: EndProcessing to end the Processing of Jobs
+  //    Pending Jobs are dropped; the call returns once the workers have exited and every
+  //    Job already handed to the Executor has finished.
+  //
+  void EndProcessing()
+  {
+    {
+      std::lock_guard<std::mutex> lock(supervisor_mutex_);
+      stop_flag_ = true;
+    }
+    supervisor_cv_.notify_all();
+    if (supervisor_.joinable())
+    {
+      supervisor_.join();
+    }
+    for (size_t i = 0; i < max_threads_; i++)
+    {
+      workers_[i].stop = true;
+    }
+    wait_.stop(queue_);
+    background_.clear();
+    for (size_t i = 0; i < max_threads_; i++)
+    {
+      if(workers_[i].thread.joinable()){
+        workers_[i].thread.join();
+      }
+      workers_[i].state = kOff;
+    }
+    executor_.drain();
+    const WorkerSnapshot total = Snapshot().total();
+    dropped_ = submitted_.load() + total.deprioritized - total.dispatched;
+  }
+
+  //
+  // @brief: Aggregate the runtime counters of the Pool (see stats.h).
+  //    Only reads counters; the workers and producers are not slowed down or locked out.
+  //
+  PoolSnapshot Snapshot() const
+  {
+    PoolSnapshot snapshot;
+    snapshot.workers.reserve(max_threads_);
+    for (size_t i = 0; i < max_threads_; i++)
+    {
+      snapshot.workers.push_back(Read(counters_[i]));
+      const uint8_t state = workers_[i].state.load(std::memory_order_relaxed);
+      snapshot.active_workers += state == kIdle || state == kBusy;
+    }
+    const WorkerSnapshot total = snapshot.total();
+
+    // Read after the workers, so that submitted never trails dispatched.
+    snapshot.submitted = submitted_.load();
+    snapshot.pending = snapshot.submitted + total.deprioritized - total.dispatched - dropped_.load();
+    snapshot.in_flight = total.dispatched - total.executed - total.late_dropped - total.coalesced - total.deprioritized;
+    if constexpr (requires { executor_.in_flight(); })
+    {
+      snapshot.in_flight += executor_.in_flight();
+    }
+    snapshot.background_pending = background_.size();
+    snapshot.background_completed = background_.completed();
+    snapshot.background_preempted = background_.preempted();
+    return snapshot;
+  }
+
+  //
+  // @brief: Number of workers the Pool runs, at the most if elastic.
+  //
+  size_t Workers() const
+  {
+    return max_threads_;
+  }
+
+  //
+  // @brief: The lock sites of the Queue and of the Wait policy, when built with LockSite
+  //    (lock_profile.h). Empty for the default, unprofiled policies.
+  //
+  std::vector<const LockSite *> LockSites() const
+  {
+    std::vector<const LockSite *> sites;
+    if constexpr (requires { wait_.lock_sites(); })
+    {
+      for (const LockSite *site : wait_.lock_sites())
+      {
+        sites.push_back(site);
+      }
+    }
+    if constexpr (requires { queue_.lock_sites(); })
+    {
+      for (const LockSite *site : queue_.lock_sites())
+      {
+        sites.push_back(site);
+      }
+    }
+    return sites;
+  }
+
+  //
+  // @brief: Record the execution timeline of the Pool from now on (see timeline.h).
+  //
+  void StartTimeline()
+  {
+    timeline_.Start();
+  }
+
+  //
+  // @brief: Stop recording and write the timeline to path as Chrome trace-event JSON.
+  //    Returns false if the file could not be written.
+  //
+  bool StopTimeline(const std::string &path)
+  {
+    timeline_.Stop();
+    return timeline_.WriteJson(path);
+  }
+
+private:
+  enum WorkerState : uint8_t
+  {
+    kOff,
+    kIdle, // Waiting for due Jobs
+    kBusy, // Handing Jobs to the Executor
+    kExited, // Returned, not joined yet
+  };
+
+  struct alignas(64) Worker
+  {
+    std::thread thread;
+    std::atomic_bool stop{false}; // Set to make the worker return: on EndProcessing, or to retire it
+    std::atomic<uint8_t> state{kOff};
+    std::atomic<int64_t> idle_since_ns{0}; // Real time the worker last went idle
+  };
+
+  //
+  // @brief: AddJob while the timeline is recording: the call is a span of the producer, and
+  //    the Job records its run, linked to it by a flow arrow.
+  //
+  void AddTimedJob(const Task::time_point_t &time_to_run, Task::task_t &&function,
+                   const LatenessPolicy &policy = LatenessPolicy::Always(),
+                   ExecutionHint hint = ExecutionHint::kAuto)
+  {
+    const Task::time_point_t begin = Task::clock_t::now();
+    const uint64_t flow = timeline_.NextFlow();
+    const int64_t ahead_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time_to_run - clock_type::now()).count();
+    const std::type_info &kind = KindOf(function);
+    Task::task_t timed = KindedJob{&kind, [this, flow, time_to_run, function = std::move(function)]() {
+      const Task::time_point_t start = Task::clock_t::now();
+      const int64_t late_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - time_to_run).count();
+      function();
+      timeline_.Span(TimelineKind::kRun, start, Task::clock_t::now(), late_ns, flow);
+    }};
+    Push(TimePointTask(time_to_run, Wrap(time_to_run, std::move(timed), policy, hint)));
+    timeline_.Span(TimelineKind::kSubmit, begin, Task::clock_t::now(), ahead_ns, flow);
+  }
+
+  //
+  // @brief: Insert task into the queue. While background Jobs are in use, then lower the
+  //    earliest timed time_point they yield to.
+  //
+  void Push(TimePointTask &&task)
+  {
+    const Task::time_point_t time_to_run = task.GetRunTimePoint();
+    wait_.push(queue_, std::move(task));
+    if (background_used_.load())
+    {
+      LowerNextDue(Nanoseconds(time_to_run));
+    }
+  }
+
+  //
+  // @brief: Lower next_due_ns_ to time_point_ns, if it is earlier.
+  //
+  void LowerNextDue(int64_t time_point_ns)
+  {
+    int64_t next_due_ns = next_due_ns_.load();
+    while (time_point_ns < next_due_ns && !next_due_ns_.compare_exchange_weak(next_due_ns, time_point_ns))
+    {
+    }
+  }
+
+  //
+  // @brief: Queue the runner of the background Jobs, due at time_to_run. Counts as submitted,
+  //    like the wake-ups of the Strands, so that the pending gauge stays balanced.
+  //
+  void PushRunner(const Task::time_point_t &time_to_run)
+  {
+    submitted_.add();
+    wait_.push(queue_, TimePointTask(time_to_run, [this]() { RunBackground(); }));
+  }
+
+  //
+  // @brief: Run background Jobs until none are left, or a timed Job is due within the
+  //    horizon: then queue the runner again for one horizon past that Job.
+  //
+  void RunBackground()
+  {
+    const std::chrono::nanoseconds horizon = background_options_.horizon;
+    while (!stop_flag_.load())
+    {
+      // Reset, then read the queue: a Push that the read misses lowers it after the reset.
+      next_due_ns_.store(std::numeric_limits<int64_t>::max());
+      const std::optional<Task::time_point_t> next = wait_.next_deadline(queue_);
+      if (next)
+      {
+        LowerNextDue(Nanoseconds(*next));
+      }
+      const Task::time_point_t now = clock_type::now();
+      if (next && *next <= now + horizon)
+      {
+        PushRunner(std::max(*next, now) + horizon);
+        return;
+      }
+
+      BackgroundJob job = background_.Pop();
+      if (!job)
+      {
+        return;
+      }
+      const BackgroundCheck check(next_due_ns_, horizon.count(), stop_flag_, &clock_type::now);
+      if (job(check))
+      {
+        background_.Completed();
+      }
+      else
+      {
+        background_.Resume(std::move(job));
+      }
+    }
+  }
+
+  //
+  // @brief: AddJob in real-time mode: function goes into the CallableArena, where moving a
+  //    task_t does not allocate. Throws std::length_error if every slot is taken.
+  //
+  void AddRealtimeJob(const Task::time_point_t &time_to_run, Task::task_t &&function)
+  {
+    if (!TryAddJob(time_to_run, std::move(function)))
+    {
+      throw std::length_error("TaskPool: real-time capacity exhausted");
+    }
+  }
+
+  //
+  // @brief: Set the calling worker up for real-time mode: prefault its stack, drop its timer
+  //    slack and move it to SCHED_FIFO if the options ask for it.
+  //
+  void PrepareRealtimeWorker(size_t index)
+  {
+    PrefaultStack(realtime_.stack_prefault);
+    const std::vector<int> &priorities = realtime_.priorities;
+    const int priority = priorities.empty() ? 0 : priorities[std::min(index, priorities.size() - 1)];
+    std::string error;
+    const bool scheduled = PrepareRealtimeThread(priority, error);
+    std::lock_guard<std::mutex> lock(realtime_mutex_);
+    if (!scheduled)
+    {
+      realtime_status_.degraded.push_back("worker " + std::to_string(index) + ": " + error);
+    }
+    else if (priority != 0)
+    {
+      ++realtime_status_.fifo_workers;
+    }
+  }
+
+  //
+  // @brief: function, wrapped into the LateJob or HintedJob the workers recognize unless
+  //    policy is Always and hint kAuto.
+  //
+  Task::task_t Wrap(const Task::time_point_t &time_to_run, Task::task_t &&function, const LatenessPolicy &policy,
+                    ExecutionHint hint = ExecutionHint::kAuto)
+  {
+    if (hint != ExecutionHint::kAuto)
+    {
+      const std::type_info &kind = KindOf(function);
+      function = HintedJob{hint, &kind, std::move(function)};
+    }
+    if (policy.action == LatenessPolicy::Action::kRun)
+    {
+      return std::move(function);
+    }
+    const std::type_info &kind = KindOf(function);
+    LateJob job{policy, time_to_run, 0, false, &kind, std::move(function)};
+    if (policy.action == LatenessPolicy::Action::kCoalesce)
+    {
+      job.sequence = coalescer_.Submit(policy.key, time_to_run);
+    }
+    return job;
+  }
+
+  //
+  // @brief: Apply the LatenessPolicy of a Job the worker took out of the queue. Returns false
+  //    if the Job was dropped or queued again, and must not run now. Free until the first
+  //    Job with a policy is added.
+  //
+  bool Admit(TimePointTask &task, WorkerCounters &counters)
+  {
+    if (!lateness_.load(std::memory_order_relaxed))
+    {
+      return true;
+    }
+    LateJob *job = task.template Target<LateJob>();
+    if (!job)
+    {
+      return true;
+    }
+    const Task::time_point_t &time_to_run = job->time_to_run;
+    const Task::time_point_t now = clock_type::now();
+    switch (job->policy.action)
+    {
+    case LatenessPolicy::Action::kDrop:
+      if (now - time_to_run > job->policy.budget)
+      {
+        Bump(counters.late_dropped);
+        return false;
+      }
+      break;
+    case LatenessPolicy::Action::kCoalesce:
+      if (coalescer_.Superseded(job->policy.key, time_to_run, job->sequence, now))
+      {
+        Bump(counters.coalesced);
+        return false;
+      }
+      break;
+    case LatenessPolicy::Action::kDeprioritize:
+      if (!job->deprioritized && now - time_to_run > job->policy.budget)
+      {
+        job->deprioritized = true;
+        Bump(counters.deprioritized);
+        Push(TimePointTask(now + job->policy.budget, task.ReleaseTask()));
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+    return true;
+  }
+
+  //
+  // @brief: Run task on the worker if its hint, or the CostEstimator, says so and the inline
+  //    budget_ns of the wake-up is not spent yet. Returns false if the Executor must run it.
+  //    Free until a Job with a hint is added or the CostEstimator is enabled.
+  //
+  bool RunInline(TimePointTask &task, int64_t &budget_ns, uint64_t &sampled, WorkerCounters &counters)
+  {
+    if constexpr (std::same_as<Exec, InlineExecutor<clock_type>>)
+    {
+      // The Executor runs every Job on the worker anyway.
+      return false;
+    }
+    else
+    {
+      const uint64_t cheap_ns = static_cast<uint64_t>(cheap_ns_.load(std::memory_order_relaxed));
+      if (cheap_ns == 0 && !hints_.load(std::memory_order_relaxed))
+      {
+        return false;
+      }
+      ExecutionHint hint = ExecutionHint::kAuto;
+      const std::type_info *kind = &KindOf(task.Function());
+      if (HintedJob *hinted = task.template Target<HintedJob>())
+      {
+        hint = hinted->hint;
+      }
+      if (hint == ExecutionHint::kPooled)
+      {
+        return false;
+      }
+      if (hint == ExecutionHint::kAuto)
+      {
+        if (cheap_ns == 0)
+        {
+          return false;
+        }
+        const uint64_t estimate = estimator_.Estimate(*kind);
+        if (estimate == 0 || estimate > cheap_ns)
+        {
+          // Unknown or expensive kind: measure it where it runs, always until its first sample
+          // is in, then one Job in kSampleInterval, in case the kind became cheap.
+          if (estimate == 0 || ++sampled % kSampleInterval == 0)
+          {
+            task = Measured(task, *kind);
+          }
+          return false;
+        }
+      }
+      if (budget_ns <= 0 || task.GetRunTimePoint() > clock_type::now())
+      {
+        return false;
+      }
+      const Task::time_point_t begin = Task::clock_t::now();
+      task();
+      const uint64_t duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Task::clock_t::now() - begin).count();
+      budget_ns -= static_cast<int64_t>(duration_ns);
+      if (cheap_ns != 0)
+      {
+        estimator_.Record(*kind, duration_ns);
+      }
+      Bump(counters.inlined);
+      return true;
+    }
+  }
+
+  //
+  // @brief: task, recording its duration into the CostEstimator once it has run.
+  //
+  TimePointTask Measured(TimePointTask &task, const std::type_info &kind)
+  {
+    return TimePointTask(task.GetRunTimePoint(), [this, &kind, function = task.ReleaseTask()]() {
+      const Task::time_point_t begin = Task::clock_t::now();
+      function();
+      estimator_.Record(kind, std::chrono::duration_cast<std::chrono::nanoseconds>(Task::clock_t::now() - begin).count());
+    });
+  }
+
+  //
+  // Pooled Jobs of a kind the CostEstimator knows as expensive that are measured anyway.
+  //
+  static constexpr uint64_t kSampleInterval = 64;
+
+  //
+  // Default inline time budget of a wake-up (see SetInlineBudget).
+  //
+  static constexpr std::chrono::microseconds kInlineBudget{50};
+
+  //
+  // @brief: Start the worker of slot index. It is a participant of the Clock until it exits.
+  //
+  void Spawn(size_t index)
+  {
+    Worker &worker = workers_[index];
+    worker.stop = false;
+    worker.idle_since_ns = Nanoseconds(Task::clock_t::now());
+    worker.state = kIdle;
+    worker.thread = std::thread(&TaskPool::WorkerThreadFunction, this, index);
+  }
+
+  static int64_t Nanoseconds(const Task::time_point_t &time_point)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count();
+  }
+
+  //
+  // @brief: Elastic sizing (elastic.h). Every interval: join the workers that retired, then
+  //    spawn a worker if the Pool is overloaded, or retire the longest idle one if it has
+  //    been idle for long enough. Real time, whatever the Clock of the Pool.
+  //
+  void Supervise()
+  {
+    const int64_t spawn_wait_ns = std::chrono::nanoseconds(elastic_.spawn_wait).count();
+    const int64_t retire_idle_ns = std::chrono::nanoseconds(elastic_.retire_idle).count();
+    int64_t last_spawn_ns = Nanoseconds(Task::clock_t::now());
+    size_t overloaded_ticks = 0;
+    std::unique_lock<std::mutex> lock(supervisor_mutex_);
+    while (!supervisor_cv_.wait_for(lock, elastic_.interval, [this]() { return stop_flag_.load(); }))
+    {
+      const int64_t now_ns = Nanoseconds(Task::clock_t::now());
+      size_t active = 0;
+      size_t busy = 0;
+      Worker *idlest = nullptr;
+      Worker *free = nullptr;
+      for (size_t i = 0; i < max_threads_; i++)
+      {
+        Worker &worker = workers_[i];
+        const uint8_t state = worker.state.load();
+        if (state == kExited)
+        {
+          worker.thread.join();
+          worker.state = kOff;
+        }
+        if (worker.state.load() == kOff)
+        {
+          free = free ? free : &worker;
+          continue;
+        }
+        if (worker.stop.load())
+        {
+          continue; // Retiring
+        }
+        ++active;
+        if (state == kBusy)
+        {
+          ++busy;
+        }
+        else if (!idlest || worker.idle_since_ns.load() < idlest->idle_since_ns.load())
+        {
+          idlest = &worker;
+        }
+      }
+
+      const int64_t waited_ns = queue_wait_ns_.exchange(0);
+      overloaded_ticks = busy == active ? overloaded_ticks + 1 : 0;
+      if ((waited_ns > spawn_wait_ns || overloaded_ticks >= elastic_.spawn_ticks) && free && active < max_threads_)
+      {
+        clock_type::add_participants(1);
+        Spawn(free - workers_.get());
+        last_spawn_ns = now_ns;
+        overloaded_ticks = 0;
+      }
+      else if (idlest && active > num_threads_ && now_ns - idlest->idle_since_ns.load() > retire_idle_ns
+               && now_ns - last_spawn_ns > retire_idle_ns)
+      {
+        idlest->stop = true;
+        if constexpr (requires { wait_.wake(); })
+        {
+          wait_.wake();
+        }
+      }
+    }
+  }
+
+  //
+  // Upper bound on the Jobs a worker takes out of the queue in one go. Large enough to make
+  // the per-batch locking negligible, small enough that a burst is still spread over workers.
+  //
+  static constexpr size_t kMaxBatch = 64;
+
+  void WorkerThreadFunction(size_t index)
+  {
+    // Utilization is measured in real time, whatever the Clock of the Pool. One clock read
+    // per wake-up and one per batch; the counters are only ever written by this worker.
+    WorkerCounters &counters = counters_[index];
+    Worker &worker = workers_[index];
+    const bool elastic = max_threads_ > num_threads_;
+    timeline_.NameThread("worker " + std::to_string(index));
+    if (arena_)
+    {
+      PrepareRealtimeWorker(index);
+    }
+    if constexpr (requires { clock_type::designate(); })
+    {
+      // One worker sleeps-then-spins up to the deadlines, the others sleep (see precision.h).
+      if (index == 0)
+      {
+        clock_type::designate();
+      }
+    }
+    uint64_t sampled = 0; // Pooled Jobs of expensive kinds, for the CostEstimator
+    Task::time_point_t mark = Task::clock_t::now();
+    const auto elapsed = [&mark]() {
+      const Task::time_point_t now = Task::clock_t::now();
+      const uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mark).count();
+      mark = now;
+      return nanoseconds;
+    };
+
+    if constexpr (BatchWaitPolicy<Wait, Queue>)
+    {
+      // Bulk path: every due Job is taken out under one lock acquisition, then executed
+      // without touching the queue again.
+      // A worker that runs its Jobs itself would keep the rest of its batch from the workers
+      // the supervisor spawns while one of them blocks: elastic Pools take one at a time.
+      const size_t max_batch = elastic && std::same_as<Exec, InlineExecutor<clock_type>> ? 1 : kMaxBatch;
+      std::vector<TimePointTask> batch;
+      batch.reserve(max_batch);
+      while (!worker.stop.load())
+      {
+        const Task::time_point_t wait_begin = mark;
+        wait_.pop_batch(queue_, worker.stop, batch, max_batch);
+        Bump(counters.idle_ns, elapsed());
+        timeline_.Span(TimelineKind::kIdle, wait_begin, mark);
+        if (batch.empty())
+        {
+          Bump(counters.spurious_wakeups);
+          continue;
+        }
+        Bump(counters.useful_wakeups);
+        Bump(counters.dispatched, batch.size());
+        const Task::time_point_t dispatch_begin = mark;
+        if (elastic)
+        {
+          Busy(worker, batch.front());
+        }
+        const size_t count = batch.size();
+        int64_t budget_ns = inline_budget_ns_.load(std::memory_order_relaxed);
+        for (TimePointTask &task : batch)
+        {
+          if (Admit(task, counters))
+          {
+            if (!RunInline(task, budget_ns, sampled, counters))
+            {
+              executor_.execute(std::move(task));
+            }
+            Bump(counters.executed);
+          }
+        }
+        batch.clear();
+        Bump(counters.busy_ns, elapsed());
+        if (elastic)
+        {
+          Idle(worker, mark);
+        }
+        timeline_.Span(TimelineKind::kDequeue, dispatch_begin, mark, count);
+      }
+    }
+    else
+    {
+      while (!worker.stop.load())
+      {
+        const Task::time_point_t wait_begin = mark;
+        std::optional<TimePointTask> task = wait_.pop(queue_, worker.stop);
+        Bump(counters.idle_ns, elapsed());
+        timeline_.Span(TimelineKind::kIdle, wait_begin, mark);
+        if (!task)
+        {
+          Bump(counters.spurious_wakeups);
+          continue;
+        }
+        Bump(counters.useful_wakeups);
+        Bump(counters.dispatched);
+        const Task::time_point_t dispatch_begin = mark;
+        if (elastic)
+        {
+          Busy(worker, *task);
+        }
+        int64_t budget_ns = inline_budget_ns_.load(std::memory_order_relaxed);
+        if (Admit(*task, counters))
+        {
+          if (!RunInline(*task, budget_ns, sampled, counters))
+          {
+            executor_.execute(std::move(*task));
+          }
+          Bump(counters.executed);
+        }
+        Bump(counters.busy_ns, elapsed());
+        if (elastic)
+        {
+          Idle(worker, mark);
+        }
+        timeline_.Span(TimelineKind::kDequeue, dispatch_begin, mark, 1);
+      }
+    }
+    clock_type::remove_participant();
+    worker.state = kExited;
+  }
+
+  //
+  // @brief: The worker took Jobs out of the queue, earliest first: record how long it waited
+  //    past its time_point for the supervisor.
+  //
+  void Busy(Worker &worker, const TimePointTask &earliest)
+  {
+    worker.state.store(kBusy, std::memory_order_relaxed);
+    const int64_t waited_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - earliest.GetRunTimePoint()).count();
+    int64_t longest = queue_wait_ns_.load(std::memory_order_relaxed);
+    while (waited_ns > longest && !queue_wait_ns_.compare_exchange_weak(longest, waited_ns, std::memory_order_relaxed))
+    {
+    }
+  }
+
+  void Idle(Worker &worker, const Task::time_point_t &now)
+  {
+    worker.idle_since_ns.store(Nanoseconds(now), std::memory_order_relaxed);
+    worker.state.store(kIdle, std::memory_order_relaxed);
+  }
+
+  Queue queue_; // Pending Jobs, ordered by their time_point
+  Wait wait_; // Synchronization between the producers and the workers
+  Exec executor_; // Runs the Jobs taken out of the queue_
+  size_t num_threads_{0}; // Number of threads in the Pool to complete the Jobs, the minimum if elastic
+  size_t max_threads_{0}; // Number of worker slots, the maximum if elastic
+  std::unique_ptr<Worker[]> workers_; // One per slot
+  std::atomic_bool stop_flag_{false}; // Set by EndProcessing: stops the supervisor and the background Jobs
+  ElasticOptions elastic_; // Only used if max_threads_ > num_threads_
+  std::thread supervisor_; // Spawns and retires workers, if elastic
+  std::mutex supervisor_mutex_; // Pairs the sleep of the supervisor with stop_flag_
+  std::condition_variable supervisor_cv_; // Signaled on stop
+  std::atomic<int64_t> queue_wait_ns_{0}; // Longest wait past its time_point of a dispatched Job, since the supervisor looked
+  std::unique_ptr<WorkerCounters[]> counters_; // One per worker, written by that worker only
+  ShardedCounter submitted_; // Jobs added through AddJob
+  std::atomic<uint64_t> dropped_{0}; // Pending Jobs dropped by EndProcessing
+  std::atomic_bool lateness_{false}; // Set once a Job with a LatenessPolicy was added
+  Coalescer coalescer_; // Latest Job of every Coalesce key
+  std::atomic_bool hints_{false}; // Set once a Job with an ExecutionHint was added
+  std::atomic<int64_t> cheap_ns_{0}; // Jobs estimated under this run inline, 0 if the CostEstimator is off
+  std::atomic<int64_t> inline_budget_ns_{std::chrono::nanoseconds(kInlineBudget).count()}; // Per wake-up
+  CostEstimator estimator_; // Duration of every kind of Job, while cheap_ns_ is set
+  Timeline timeline_; // Execution timeline, recorded between StartTimeline and StopTimeline
+  BackgroundQueue background_; // Background Jobs, run by a runner queued among the timed Jobs
+  BackgroundOptions background_options_;
+  std::atomic_bool background_used_{false}; // Set once a background Job was added
+  std::atomic<int64_t> next_due_ns_{std::numeric_limits<int64_t>::max()}; // Earliest timed time_point, for BackgroundCheck
+  RealtimeOptions realtime_; // Only used in real-time mode
+  std::unique_ptr<CallableArena> arena_; // Callables of the Jobs, set in real-time mode only
+  mutable std::mutex realtime_mutex_; // Guards realtime_status_
+  RealtimeStatus realtime_status_; // Written by StartProcessingJobs and the starting workers
+};
+
+//
+// Version-0: ordered set guarded by one mutex, workers sleep on a condition_variable until the
+// earliest Task is due.
+//
+using SetTaskPool = TaskPool<SetQueue, CondVarWait<>, AsyncExecutor<>>;
+
+//
+// Version-1: hand-over-hand locked ThreadSafeOrderedList. Workers read the earliest
+// time_point of the list without locking, sleep until it is due and take the whole due prefix
+// with pop_until; every Job runs on a fire-and-forget thread.
+//
+using ListTaskPool = TaskPool<OrderedListQueue, PeekingWait<>, AsyncExecutor<>>;
+
+//
+// Lazy: Version-1 with the lazily synchronized LazyOrderedList, inserts walk the list without
+// locking it.
+//
+using LazyListTaskPool = TaskPool<LazyListQueue, PeekingWait<>, AsyncExecutor<>>;
+
+//
+// Compact: struct-of-arrays CompactQueue for tens of millions of pending timers. Jobs run on
+// the workers, a thread per Job would defeat the purpose at that scale.
+//
+using CompactTaskPool = TaskPool<CompactQueue<>, CondVarWait<>, InlineExecutor<>>;
+
+//
+// Block: bucketed BlockQueue, workers take every due Job out in one vectorized pass.
+//
+using BlockTaskPool = TaskPool<BlockQueue<>, CondVarWait<>, InlineExecutor<>>;
+
+//
+// Bucket: one BucketQueue node per distinct deadline, for producers that quantize deadlines.
+//
+using BucketTaskPool = TaskPool<BucketQueue, CondVarWait<>, InlineExecutor<>>;
+
+//
+// Virtual: Version-0 queue and locking on simulated time. Jobs run on the workers, and the
+// clock jumps to the next deadline as soon as every worker is idle (see VirtualClock).
+//
+using VirtualTaskPool = TaskPool<SetQueue, CondVarWait<VirtualClock>, InlineExecutor<VirtualClock>>;
+
+//
+// Precise: Version-0 queue and locking on the PrecisionClock. Worker 0 sleeps until a
+// calibrated margin before the earliest deadline and spins the rest of the way, and runs the
+// Job itself: a thread per Job would add back the latency the spin takes out.
+//
+using PreciseTaskPool = TaskPool<SetQueue, CondVarWait<PrecisionClock>, InlineExecutor<PrecisionClock>>;
+
+//
+// Realtime: preallocated FixedQueue, Jobs run on the workers. Call SetRealtime before
+// StartProcessingJobs to preallocate the callables too and set the workers up (realtime.h).
+//
+using RealtimeTaskPool = TaskPool<FixedQueue, CondVarWait<>, InlineExecutor<>>;
+
+//
+// Profiled: Version-0, Version-1 and Lazy with lock contention profiling (see LockSites()).
+//
+using ProfiledSetTaskPool = TaskPool<SetQueue, CondVarWait<SteadyClock, LockSite>, AsyncExecutor<>>;
+using ProfiledListTaskPool = TaskPool<ThreadSafeOrderedList<TimePointTask, LockSite>, PeekingWait<>, AsyncExecutor<>>;
+using ProfiledLazyListTaskPool = TaskPool<LazyOrderedList<TimePointTask, LockSite>, PeekingWait<>, AsyncExecutor<>>;
+
+//
+// Timeline: Version-0 and Version-1 with the contended queue lock acquisitions in the
+// execution timeline (see StartTimeline).
+//
+using TimelineSetTaskPool = TaskPool<SetQueue, CondVarWait<SteadyClock, TimelineLockSite>, AsyncExecutor<>>;
+using TimelineListTaskPool = TaskPool<ThreadSafeOrderedList<TimePointTask, TimelineLockSite>, PeekingWait<>, AsyncExecutor<>>;
+} // namespace job_manager
+} // namespace vm
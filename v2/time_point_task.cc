@@ -0,0 +1,69 @@
+#include "time_point_task.h"
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Base class to hold Task types
+//
+
+// Constructor to copy the task
+Task::Task(const task_t& task): task_(task)
+{
+}
+
+// Constructor to move the r-value reference task
+Task::Task(task_t &&task) : task_(std::move(task))
+{
+}
+
+// Executes the task function.
+void Task::operator()(void)
+{
+  if (task_)
+  {
+    task_();
+  }
+}
+
+// Moves the function object out, leaving the Task empty.
+Task::task_t Task::ReleaseTask()
+{
+  return std::move(task_);
+}
+
+
+//
+// @brief: Constructor to contruct the TimePointTask using copies of time_point and task
+// @param: time_point: const-reference to steady_time::time_point type
+// @param: task: const-reference to function<void()> type
+//
+TimePointTask::TimePointTask(const time_point_t &time_point, const task_t &task)
+    : Task(task),
+      to_run_at_(time_point) {}
+
+//
+// @brief: Constructor to contruct the TimePointTask using r-value-refs of time_point and task
+// @param: time_point: r-value-reference to steady_time::time_point type
+// @param: task: r-value-reference to function<void()> type
+//
+TimePointTask::TimePointTask(const time_point_t &time_point, task_t &&task)
+    : Task(std::move(task)),
+      to_run_at_(time_point) {}
+
+//
+// @brief: Operator<= overload to compare two time_point tasks.
+//
+bool TimePointTask::operator<= (const TimePointTask& rhs) const {
+  return to_run_at_ <= rhs.to_run_at_;
+}
+
+//
+// @brief: Operator< overload to compare two time_point tasks.
+//
+bool TimePointTask::operator< (const TimePointTask& rhs) const {
+  return to_run_at_ < rhs.to_run_at_;
+}
+} // namespace job_manager
+} // namespace vm
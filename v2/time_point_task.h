@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <typeinfo>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Base class to hold Task types
+//
+class Task {
+public:
+  using task_t = std::function<void(void)>; // public typedef to alias the function object
+  using clock_t = std::chrono::steady_clock;
+  using time_point_t = std::chrono::time_point<clock_t>;
+
+  // Constructor to copy the task
+  Task(const task_t& task);
+
+  // Constructor to move the r-value reference task
+  Task(task_t &&task);
+
+  // Executes the task function.
+  // Non-virtual on purpose: the TaskPool always knows the concrete task type,
+  // so there is no reason to pay for a vtable pointer and an indirect call per Job.
+  void operator()(void);
+
+  // Moves the function object out, leaving the Task empty. Used by the Pending-Queues that
+  // store the function object apart from the time_point.
+  task_t ReleaseTask();
+
+  // The function object if it holds an F, nullptr otherwise. Lets the TaskPool recognize the
+  // Jobs it wrapped itself (see lateness.h).
+  template <typename F>
+  F *Target() {
+    return task_.template target<F>();
+  }
+
+  // Type of the function object, typeid(void) if the Task is empty.
+  const std::type_info &TargetType() const {
+    return task_.target_type();
+  }
+
+  // The function object, read-only. Lets the TaskPool look into the Jobs it wrapped.
+  const task_t &Function() const {
+    return task_;
+  }
+
+protected:
+  task_t task_;
+};
+
+//
+// TimePointTask: This Task type has a time_point attribute that can be used to perform
+// time_point based scheduling of these tasks.
+//
+// Unlike Version-0/1 the TimePointTask does not record when it was received: reading the clock
+// for every Task (twice for the compact Pending-Queues, which re-create the Task on pop) cost
+// more than the bulk extraction itself, and nothing reads it.
+//
+// The TimePointTask no longer decides *how* it is executed either. Running the
+// task on the worker or on a fire-and-forget async thread is the job of the Executor policy
+// of the TaskPool (see executor.h).
+//
+class TimePointTask: public Task
+{
+public:
+  //
+  // @brief: Constructor to contruct the TimePointTask using copies of time_point and task
+  // @param: time_point: const-reference to steady_time::time_point type
+  // @param: task: const-reference to function<void()> type
+  //
+  TimePointTask(const time_point_t &time_point, const task_t &task);
+
+  //
+  // @brief: Constructor to contruct the TimePointTask using r-value-refs of time_point and task
+  // @param: time_point: r-value-reference to steady_time::time_point type
+  // @param: task: r-value-reference to function<void()> type
+  //
+  TimePointTask(const time_point_t &time_point, task_t &&task);
+
+  //
+  // @brief: Operator<= overload to compare two time_point tasks.
+  //
+  bool operator<= (const TimePointTask& rhs) const;
+
+  //
+  // @brief: Operator< overload to compare two time_point tasks.
+  //
+  bool operator< (const TimePointTask& rhs) const;
+
+  //
+  // @brief: get to_run_at_
+  //
+  inline time_point_t GetRunTimePoint() const {
+    return to_run_at_;
+  };
+
+private:
+  time_point_t to_run_at_; // steady Time
+};
+} // namespace job_manager
+} // namespace vm
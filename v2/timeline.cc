@@ -0,0 +1,262 @@
+#include "timeline.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace vm
+{
+namespace job_manager
+{
+namespace
+{
+const char *Name(TimelineKind kind)
+{
+  switch (kind)
+  {
+  case TimelineKind::kSubmit:
+    return "QueueJob";
+  case TimelineKind::kRun:
+    return "run";
+  case TimelineKind::kIdle:
+    return "idle";
+  case TimelineKind::kDequeue:
+    return "dequeue";
+  case TimelineKind::kLockWait:
+    return "lock wait";
+  }
+  return "?";
+}
+} // namespace
+
+Timeline::Slot::~Slot()
+{
+  Release();
+}
+
+void Timeline::Slot::Release()
+{
+  if (ring)
+  {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    shared->free.push_back(ring);
+  }
+  ring = nullptr;
+  shared.reset();
+}
+
+Timeline::Slot &Timeline::LocalSlot()
+{
+  thread_local Slot slot;
+  return slot;
+}
+
+void Timeline::Push(Ring &ring, const TimelineEvent &event)
+{
+  const uint64_t head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) >= kRingEvents)
+  {
+    Bump(ring.dropped);
+    return;
+  }
+  ring.events[head % kRingEvents] = event;
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Timeline::Record(const std::shared_ptr<Shared> &shared, TimelineEvent event)
+{
+  if (!shared->enabled.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  Slot &slot = LocalSlot();
+  if (slot.shared != shared)
+  {
+    // First event of this thread for this Timeline: take over the ring of an exited thread,
+    // or add one.
+    slot.Release();
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    if (shared->free.empty())
+    {
+      // Default-initialized: the events stay untouched (and unbacked) until written.
+      shared->rings.push_back(std::unique_ptr<Ring>(new Ring));
+      slot.ring = shared->rings.back().get();
+    }
+    else
+    {
+      slot.ring = shared->free.back();
+      shared->free.pop_back();
+    }
+    slot.shared = shared;
+  }
+  event.thread = ThreadIndex();
+  Push(*slot.ring, event);
+}
+
+void Timeline::LockWait(const char *site, uint64_t wait_ns)
+{
+  Slot &slot = LocalSlot();
+  if (!slot.ring || !slot.shared->enabled.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  const int64_t end = Nanoseconds(Task::clock_t::now());
+  Push(*slot.ring, {end - static_cast<int64_t>(wait_ns), end, 0, 0, site, ThreadIndex(), TimelineKind::kLockWait});
+}
+
+Timeline::Timeline()
+  : shared_(std::make_shared<Shared>())
+{
+}
+
+Timeline::~Timeline()
+{
+  Stop();
+}
+
+void Timeline::Start()
+{
+  Stop();
+  Collect();
+  {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    events_.clear();
+    overflow_ = 0;
+    origin_ns_ = Nanoseconds(Task::clock_t::now());
+  }
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    for (const std::unique_ptr<Ring> &ring : shared_->rings)
+    {
+      ring->dropped.store(0, std::memory_order_relaxed);
+    }
+  }
+  stop_ = false;
+  shared_->enabled = true;
+  collector_ = std::thread(&Timeline::Run, this);
+}
+
+void Timeline::Stop()
+{
+  shared_->enabled = false;
+  if (!collector_.joinable())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(collector_mutex_);
+    stop_ = true;
+  }
+  collector_cv_.notify_all();
+  collector_.join();
+  Collect();
+}
+
+uint64_t Timeline::dropped() const
+{
+  uint64_t sum = 0;
+  {
+    std::lock_guard<std::mutex> lock(events_mutex_);
+    sum += overflow_;
+  }
+  std::lock_guard<std::mutex> lock(shared_->mutex);
+  for (const std::unique_ptr<Ring> &ring : shared_->rings)
+  {
+    sum += ring->dropped.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Timeline::NameThread(std::string name)
+{
+  std::lock_guard<std::mutex> lock(shared_->mutex);
+  shared_->names[ThreadIndex()] = std::move(name);
+}
+
+void Timeline::Collect()
+{
+  std::lock_guard<std::mutex> events_lock(events_mutex_);
+  std::lock_guard<std::mutex> lock(shared_->mutex);
+  for (const std::unique_ptr<Ring> &ring : shared_->rings)
+  {
+    const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    for (uint64_t i = tail; i < head; ++i)
+    {
+      if (events_.size() < kMaxEvents)
+      {
+        events_.push_back(ring->events[i % kRingEvents]);
+      }
+      else
+      {
+        ++overflow_;
+      }
+    }
+    ring->tail.store(head, std::memory_order_release);
+  }
+}
+
+void Timeline::Run()
+{
+  std::unique_lock<std::mutex> lock(collector_mutex_);
+  while (!collector_cv_.wait_for(lock, std::chrono::milliseconds(10), [this]() { return stop_; }))
+  {
+    lock.unlock();
+    Collect();
+    lock.lock();
+  }
+}
+
+bool Timeline::WriteJson(const std::string &path) const
+{
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "w"), &std::fclose);
+  if (!file)
+  {
+    return false;
+  }
+  std::FILE *out = file.get();
+  std::fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  std::fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"job_manager\"}}");
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    for (const auto &[thread, name] : shared_->names)
+    {
+      std::fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"%s\"}}",
+                   thread, name.c_str());
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(events_mutex_);
+  for (const TimelineEvent &event : events_)
+  {
+    const double ts = (event.begin_ns - origin_ns_) / 1e3;
+    const double dur = (event.end_ns - event.begin_ns) / 1e3;
+    std::fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"job_manager\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%.3f,\"dur\":%.3f",
+                 Name(event.kind), event.thread, ts, dur);
+    switch (event.kind)
+    {
+    case TimelineKind::kSubmit:
+      std::fprintf(out, ",\"args\":{\"to_run_in_us\":%.3f}}", event.value / 1e3);
+      std::fprintf(out, ",\n{\"name\":\"job\",\"cat\":\"job\",\"ph\":\"s\",\"id\":%" PRIu64 ",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%.3f}",
+                   event.flow, event.thread, ts);
+      break;
+    case TimelineKind::kRun:
+      std::fprintf(out, ",\"args\":{\"late_us\":%.3f}}", event.value / 1e3);
+      std::fprintf(out, ",\n{\"name\":\"job\",\"cat\":\"job\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%" PRIu64 ",\"pid\":1,\"tid\":%" PRIu32 ",\"ts\":%.3f}",
+                   event.flow, event.thread, ts);
+      break;
+    case TimelineKind::kDequeue:
+      std::fprintf(out, ",\"args\":{\"jobs\":%" PRId64 "}}", event.value);
+      break;
+    case TimelineKind::kLockWait:
+      std::fprintf(out, ",\"args\":{\"site\":\"%s\"}}", event.label);
+      break;
+    default:
+      std::fprintf(out, "}");
+      break;
+    }
+  }
+  std::fprintf(out, "\n]}\n");
+  return std::fflush(out) == 0 && !std::ferror(out);
+}
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "stats.h"
+#include "time_point_task.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Timeline: execution timeline of a TaskPool, exported as Chrome trace-event JSON (opens in
+// Perfetto or chrome://tracing).
+//
+// While a Timeline is started, the Pool records spans per thread:
+//  - QueueJob: the AddJob call on the producer, the start of a flow arrow to the Job's run
+//  - run:      the Job itself, on whichever thread executed it, the end of the flow arrow
+//  - idle:     a worker waiting in the Wait policy for due Jobs
+//  - dequeue:  a worker handing the Jobs it took out of the queue to the Executor
+//  - lock wait: a contended acquisition of the queue mutex (TimelineLockSite pools only)
+//
+// Every thread appends to a ring buffer of its own, without locks or allocation: a relaxed
+// load of the enabled flag when stopped, one store and a release when started. A full ring
+// drops the event (see dropped()). A collector thread drains the rings every few milliseconds
+// while recording. Rings outlive their thread: when it exits the ring goes back to the
+// Timeline and is handed to the next new thread, so the one-thread-per-Job AsyncExecutor
+// needs no more rings than it has threads alive at once.
+//
+// Timestamps are real (steady_clock) time, whatever the Clock of the Pool; the lateness of
+// the Jobs is measured on the Pool's Clock.
+//
+enum class TimelineKind : uint32_t
+{
+  kSubmit,
+  kRun,
+  kIdle,
+  kDequeue,
+  kLockWait,
+};
+
+struct TimelineEvent
+{
+  int64_t begin_ns;
+  int64_t end_ns;
+  int64_t value; // kSubmit: ns until the deadline; kRun: lateness in ns; kDequeue: Job count
+  uint64_t flow; // kSubmit / kRun: id of the flow arrow between them
+  const char *label; // kLockWait: name of the lock site
+  uint32_t thread; // ThreadIndex() of the recording thread
+  TimelineKind kind;
+};
+
+class Timeline
+{
+public:
+  static constexpr size_t kRingEvents = 4096; // Per thread, between two collections
+  static constexpr size_t kMaxEvents = size_t{1} << 22; // Collected, about 200 MB
+
+  Timeline();
+  ~Timeline();
+
+  Timeline(const Timeline &other) = delete;
+  Timeline &operator=(const Timeline &other) = delete;
+
+  //
+  // @brief: Discard what was recorded so far and start recording.
+  //
+  void Start();
+
+  //
+  // @brief: Stop recording and collect what the rings still hold.
+  //
+  void Stop();
+
+  bool enabled() const
+  {
+    return shared_->enabled.load(std::memory_order_relaxed);
+  }
+
+  //
+  // @brief: Write the collected events to path as Chrome trace-event JSON. Returns false if
+  //    the file could not be written.
+  //
+  bool WriteJson(const std::string &path) const;
+
+  //
+  // @brief: Events lost to full rings since Start.
+  //
+  uint64_t dropped() const;
+
+  //
+  // @brief: Show the calling thread as name in the timeline (ex. "worker 2").
+  //
+  void NameThread(std::string name);
+
+  uint64_t NextFlow()
+  {
+    return next_flow_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //
+  // @brief: Append a span of the calling thread, if recording.
+  //
+  void Span(TimelineKind kind, Task::time_point_t begin, Task::time_point_t end, int64_t value = 0,
+            uint64_t flow = 0)
+  {
+    if (enabled())
+    {
+      Record(shared_, {Nanoseconds(begin), Nanoseconds(end), value, flow, nullptr, 0, kind});
+    }
+  }
+
+  //
+  // @brief: Append a lock wait of the calling thread to the last Timeline it recorded to, if
+  //    that one is still recording. Used by TimelineLockSite, which has no Pool at hand.
+  //
+  static void LockWait(const char *site, uint64_t wait_ns);
+
+private:
+  //
+  // Single-producer single-consumer ring: the owning thread appends, the collector drains.
+  //
+  struct Ring
+  {
+    std::array<TimelineEvent, kRingEvents> events;
+    alignas(64) std::atomic<uint64_t> head{0}; // Next slot to write, owning thread only
+    alignas(64) std::atomic<uint64_t> tail{0}; // Next slot to read, collector only
+    std::atomic<uint64_t> dropped{0};
+  };
+
+  //
+  // State shared with the threads' ring slots, which may outlive the Timeline.
+  //
+  struct Shared
+  {
+    std::atomic_bool enabled{false};
+    std::mutex mutex; // Guards rings, free and names
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Ring *> free; // Rings of exited threads
+    std::map<uint32_t, std::string> names;
+  };
+
+  static int64_t Nanoseconds(Task::time_point_t time_point)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count();
+  }
+
+  //
+  // The calling thread's ring, and the Timeline it belongs to.
+  //
+  struct Slot
+  {
+    ~Slot();
+    void Release();
+
+    std::shared_ptr<Shared> shared;
+    Ring *ring{nullptr};
+  };
+
+  static Slot &LocalSlot();
+  static void Push(Ring &ring, const TimelineEvent &event);
+  static void Record(const std::shared_ptr<Shared> &shared, TimelineEvent event);
+
+  void Collect();
+  void Run();
+
+  std::shared_ptr<Shared> shared_;
+  std::atomic<uint64_t> next_flow_{1};
+  mutable std::mutex events_mutex_; // Guards events_, serializes Collect
+  std::vector<TimelineEvent> events_; // Collected so far
+  uint64_t overflow_{0}; // Events collected past kMaxEvents
+  int64_t origin_ns_{0}; // Start time, the zero of the JSON timestamps
+  std::mutex collector_mutex_; // Guards stop_
+  std::condition_variable collector_cv_; // Signaled on Stop
+  bool stop_{false};
+  std::thread collector_;
+};
+
+//
+// TimelineLockSite: lock site policy (lock_profile.h) that records contended acquisitions of
+// the queue mutex as lock wait spans of the Timeline the thread records to.
+//
+class TimelineLockSite
+{
+public:
+  explicit TimelineLockSite(const char *name) : name_(name) {}
+
+  void record_acquisition(uint64_t wait_ns, bool contended, size_t)
+  {
+    if (contended)
+    {
+      Timeline::LockWait(name_, wait_ns);
+    }
+  }
+
+  void record_hold(uint64_t) {}
+
+private:
+  const char *name_;
+};
+} // namespace job_manager
+} // namespace vm
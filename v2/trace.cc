@@ -0,0 +1,95 @@
+#include "trace.h"
+
+#include <stdexcept>
+
+namespace vm
+{
+namespace job_manager
+{
+TraceRecorder::TraceRecorder(const std::string &path)
+  : file_(std::fopen(path.c_str(), "wb"))
+{
+  if (!file_)
+  {
+    throw std::runtime_error("TraceRecorder: cannot create " + path);
+  }
+  TraceHeader header;
+  header.record_size = sizeof(TraceRecord);
+  std::fwrite(&header, sizeof(header), 1, file_);
+}
+
+TraceRecorder::~TraceRecorder()
+{
+  Flush();
+  std::fclose(file_);
+}
+
+void TraceRecorder::Append(const TraceRecord &record)
+{
+  Buffer &buffer = buffers_[ThreadIndex() % kShards];
+  std::vector<TraceRecord> full;
+  {
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.records.push_back(record);
+    if (buffer.records.size() < kBufferRecords)
+    {
+      return;
+    }
+    full.reserve(kBufferRecords);
+    full.swap(buffer.records);
+  }
+  Write(full);
+}
+
+void TraceRecorder::Flush()
+{
+  for (Buffer &buffer : buffers_)
+  {
+    std::vector<TraceRecord> records;
+    {
+      std::lock_guard<std::mutex> lock(buffer.mutex);
+      records.swap(buffer.records);
+    }
+    Write(records);
+  }
+  std::lock_guard<std::mutex> file_lock(file_mutex_);
+  std::fflush(file_);
+}
+
+std::vector<TraceRecord> TraceRecorder::Load(const std::string &path)
+{
+  std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+  if (!file)
+  {
+    throw std::runtime_error("TraceRecorder: cannot open " + path);
+  }
+
+  TraceHeader header;
+  if (std::fread(&header, sizeof(header), 1, file.get()) != 1
+      || header.magic != TraceHeader::kMagic
+      || header.version != TraceHeader::kVersion
+      || header.record_size != sizeof(TraceRecord))
+  {
+    throw std::runtime_error("TraceRecorder: " + path + " is not a version 1 trace");
+  }
+
+  std::vector<TraceRecord> records;
+  TraceRecord chunk[kBufferRecords];
+  while (const size_t count = std::fread(chunk, sizeof(TraceRecord), kBufferRecords, file.get()))
+  {
+    records.insert(records.end(), chunk, chunk + count);
+  }
+  return records;
+}
+
+void TraceRecorder::Write(std::vector<TraceRecord> &records)
+{
+  if (records.empty())
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(file_mutex_);
+  std::fwrite(records.data(), sizeof(TraceRecord), records.size(), file_);
+}
+} // namespace job_manager
+} // namespace vm
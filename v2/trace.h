@@ -0,0 +1,102 @@
+#pragma once
+
+#include "stats.h"
+#include "time_point_task.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// TraceRecorder: compact binary trace of the Jobs queued through a JobManager.
+//
+// A trace file is a TraceHeader followed by fixed-size TraceRecords, one per executed Job.
+// A record is written once the Job has run (that is when its duration is known), so the
+// records of a file are in completion order, not submission order; Jobs dropped by End are
+// not recorded. Times are nanoseconds of the Pool's clock.
+//
+// Recording is meant to stay on in production: a Job appends its record to one of kShards
+// buffers, picked by the index of the thread that ran it, and only a full buffer is written
+// out (one fwrite under the file lock per kBufferRecords Jobs). The shards are fixed rather
+// than per thread because the fire-and-forget Executor runs every Job on a thread of its own.
+//
+struct TraceHeader
+{
+  static constexpr uint32_t kMagic = 0x544a4d56; // "VMJT"
+  static constexpr uint32_t kVersion = 1;
+
+  uint32_t magic{kMagic};
+  uint32_t version{kVersion};
+  uint32_t record_size{0};
+  uint32_t reserved{0};
+};
+
+struct TraceRecord
+{
+  int64_t submit_ns; // Time QueueJob was called
+  int64_t offset_ns; // time_to_run - submit time, negative for Jobs queued in the past
+  int64_t duration_ns; // Measured run time of the Job itself
+  uint32_t thread; // Small index of the submitting thread (see ThreadIndex in stats.h)
+  uint32_t reserved;
+};
+
+static_assert(sizeof(TraceRecord) == 32);
+
+class TraceRecorder
+{
+public:
+  static constexpr size_t kBufferRecords = 1024;
+  static constexpr size_t kShards = 16;
+
+  //
+  // @brief: Create (truncate) the trace file at path. Throws std::runtime_error on failure.
+  //
+  explicit TraceRecorder(const std::string &path);
+
+  //
+  // @brief: Write every buffered record out and close the file.
+  //
+  ~TraceRecorder();
+
+  TraceRecorder(const TraceRecorder &other) = delete;
+  TraceRecorder &operator=(const TraceRecorder &other) = delete;
+
+  //
+  // @brief: Buffer record in the calling thread's shard, writing the shard out once full.
+  //
+  void Append(const TraceRecord &record);
+
+  //
+  // @brief: Write out what every thread has buffered so far.
+  //
+  void Flush();
+
+  //
+  // @brief: Read every record of the trace file at path. Throws std::runtime_error if the
+  //    file cannot be read or is not a trace.
+  //
+  static std::vector<TraceRecord> Load(const std::string &path);
+
+private:
+  struct alignas(64) Buffer
+  {
+    std::mutex mutex; // Contended only by threads that share the shard, and by Flush
+    std::vector<TraceRecord> records;
+  };
+
+  void Write(std::vector<TraceRecord> &records);
+
+  std::FILE *file_{nullptr};
+  std::mutex file_mutex_; // Serializes the writes to file_
+  std::array<Buffer, kShards> buffers_; // Records not written out yet
+};
+} // namespace job_manager
+} // namespace vm
@@ -0,0 +1,404 @@
+#pragma once
+
+#include "clock.h"
+#include "lock_profile.h"
+#include "pending_queue.h"
+#include "time_point_task.h"
+
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+namespace vm
+{
+namespace job_manager
+{
+//
+// Locking/Wait policies of the TaskPool.
+//
+// The Wait policy owns whatever synchronization is needed around the Pending-Queue:
+// how producers insert a Task and wake the workers up, and how a worker waits until it
+// can take a Task out of the queue. Time is read, and waited for, through the Clock policy
+// (clock.h) the Wait policy is instantiated with.
+//
+
+//
+// @brief: Requirements on a Wait policy W driving the Pending-Queue Q
+//    push: insert a Task and notify the workers if needed
+//    pop:  block until a Task can be dispatched or stop is set. Returns std::nullopt on stop
+//          (or when the policy wants the worker to re-check stop).
+//    stop: wake every worker blocked in pop and drop the pending Tasks
+//
+// A policy whose workers block can also have wake(): wake them all up, so that the one whose
+// stop flag was set returns (see ElasticOptions), without touching the queue.
+//
+template <typename W, typename Q>
+concept WaitPolicy = requires(W &wait, Q &queue, TimePointTask &&task, const std::atomic_bool &stop) {
+  wait.push(queue, std::move(task));
+  { wait.pop(queue, stop) } -> std::same_as<std::optional<TimePointTask>>;
+  wait.stop(queue);
+};
+
+//
+// @brief: A Wait policy that can also hand a worker every due Task at once (pop_batch).
+//    pop_batch blocks like pop, then appends up to max_count due Tasks to out and returns
+//    how many it appended (0 on stop).
+//
+template <typename W, typename Q>
+concept BatchWaitPolicy = WaitPolicy<W, Q>
+  && requires(W &wait, Q &queue, const std::atomic_bool &stop, std::vector<TimePointTask> &out, size_t max_count) {
+  { wait.pop_batch(queue, stop, out, max_count) } -> std::convertible_to<size_t>;
+};
+
+//
+// CondVarWait: Version-0 locking. One mutex guards the whole queue and the workers sleep
+// on a condition_variable until the earliest Task is due. Only due Tasks are popped.
+//
+// Site selects lock profiling of the queue mutex (lock_profile.h), per operation.
+//
+template <Clock Clk = SteadyClock, typename Site = NoLockSite>
+class CondVarWait
+{
+public:
+  using clock_type = Clk;
+
+  //
+  // @brief: Insert the task and wake a worker up if the task became the new earliest one
+  //    or is already due.
+  //
+  template <OrderedPendingQueue Q>
+  void push(Q &queue, TimePointTask &&task)
+  {
+    lock_t lock(mutex_, push_site_);
+    const Task::time_point_t time_to_run = task.GetRunTimePoint();
+    const bool notify = queue.empty()
+      || (time_to_run < queue.earliest())
+      || (Clk::now() >= time_to_run);
+    queue.insert(std::move(task));
+
+    if(notify){
+      lock.unlock();
+      cv_.notify_one();
+    }
+  }
+
+  //
+  // @brief: Wait until the earliest Task is due and pop it.
+  //    The earliest time_point is re-read after every wake-up, so a Task that is inserted
+  //    in front of the one we are sleeping on shortens the wait.
+  //
+  template <OrderedPendingQueue Q>
+  std::optional<TimePointTask> pop(Q &queue, const std::atomic_bool &stop)
+  {
+    lock_t lock(mutex_, pop_site_);
+    while (!stop.load())
+    {
+      if (queue.empty())
+      {
+        lock.released([&]() { Clk::wait(cv_, lock.native()); });
+        continue;
+      }
+
+      const Task::time_point_t earliest_time_point = queue.earliest();
+      if (Clk::now() >= earliest_time_point)
+      {
+        return queue.pop_front();
+      }
+      lock.released([&]() { Clk::wait_until(cv_, lock.native(), earliest_time_point); });
+    }
+    return std::nullopt;
+  }
+
+  //
+  // @brief: Wait until the earliest Task is due, then take every due Task (up to max_count)
+  //    out of the queue under a single lock acquisition. If due Tasks are left behind another
+  //    worker is woken up to take the next batch.
+  //
+  template <OrderedPendingQueue Q, typename Container>
+    requires BatchPendingQueue<Q>
+  size_t pop_batch(Q &queue, const std::atomic_bool &stop, Container &out, size_t max_count)
+  {
+    lock_t lock(mutex_, pop_site_);
+    while (!stop.load())
+    {
+      if (queue.empty())
+      {
+        lock.released([&]() { Clk::wait(cv_, lock.native()); });
+        continue;
+      }
+
+      const Task::time_point_t earliest_time_point = queue.earliest();
+      const Task::time_point_t now = Clk::now();
+      if (now >= earliest_time_point)
+      {
+        const size_t popped = queue.pop_until(now, out, max_count);
+        const bool more = !queue.empty() && queue.earliest() <= now;
+        lock.unlock();
+        if (more)
+        {
+          cv_.notify_one();
+        }
+        return popped;
+      }
+      lock.released([&]() { Clk::wait_until(cv_, lock.native(), earliest_time_point); });
+    }
+    return 0;
+  }
+
+  //
+  // @brief: time_point of the earliest Task, std::nullopt if the queue is empty.
+  //
+  template <OrderedPendingQueue Q>
+  std::optional<Task::time_point_t> next_deadline(Q &queue)
+  {
+    lock_t lock(mutex_, pop_site_);
+    if (queue.empty())
+    {
+      return std::nullopt;
+    }
+    return queue.earliest();
+  }
+
+  //
+  // @brief: Drop the pending Tasks and wake every worker up so it can see the stop flag.
+  //
+  template <OrderedPendingQueue Q>
+  void stop(Q &queue)
+  {
+    lock_t lock(mutex_, stop_site_);
+    queue.clear();
+    lock.unlock();
+    cv_.notify_all();
+  }
+
+  //
+  // @brief: Wake every worker up so it re-checks its stop flag. The queue is left alone.
+  //
+  void wake()
+  {
+    {
+      lock_t lock(mutex_, stop_site_);
+    }
+    cv_.notify_all();
+  }
+
+  //
+  // @brief: Make the queue mutex priority-inheriting (PTHREAD_PRIO_INHERIT): a thread holding
+  //    it runs at the priority of the highest one waiting for it (see realtime.h). Only before
+  //    any thread uses the mutex. Returns false, and leaves a plain mutex, if unsupported.
+  //
+  bool inherit_priority()
+  {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    bool inherited = pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT) == 0;
+    if (inherited)
+    {
+      pthread_mutex_destroy(mutex_.native_handle());
+      inherited = pthread_mutex_init(mutex_.native_handle(), &attr) == 0;
+      if (!inherited)
+      {
+        pthread_mutex_init(mutex_.native_handle(), nullptr);
+      }
+    }
+    pthread_mutexattr_destroy(&attr);
+    return inherited;
+  }
+
+  //
+  // @brief: The lock sites of the queue mutex, for reporting. Only with lock profiling enabled.
+  //
+  std::vector<const LockSite *> lock_sites() const
+    requires std::same_as<Site, LockSite>
+  {
+    return {&push_site_, &pop_site_, &stop_site_};
+  }
+
+private:
+  using lock_t = ProfiledLock<Site>;
+
+  std::mutex mutex_; // Mutex for exclusive access of the queue
+  std::condition_variable cv_; // Conditin_Variable for signaling the threads
+  [[no_unique_address]] Site push_site_{"wait.push"};
+  [[no_unique_address]] Site pop_site_{"wait.pop"};
+  [[no_unique_address]] Site stop_site_{"wait.stop"};
+};
+
+//
+// PollingWait: Version-1 locking. No lock around the queue, producers and workers go
+// straight to the ConcurrentPendingQueue. Workers pop the front as soon as there is one,
+// whether it is due or not; the Executor is responsible for not running it early.
+//
+// The workers never block in the Clock, so PollingWait cannot drive a VirtualClock.
+//
+template <Clock Clk = SteadyClock>
+class PollingWait
+{
+public:
+  using clock_type = Clk;
+
+  template <ConcurrentPendingQueue Q>
+  void push(Q &queue, TimePointTask &&task)
+  {
+    queue.insert(std::move(task));
+  }
+
+  template <ConcurrentPendingQueue Q>
+  std::optional<TimePointTask> pop(Q &queue, const std::atomic_bool &stop)
+  {
+    std::unique_ptr<TimePointTask> task = queue.pop();
+    if (!task)
+    {
+      // Nothing to pop: give the core away instead of hammering the head mutex.
+      std::this_thread::yield();
+      return std::nullopt;
+    }
+    return std::move(*task);
+  }
+
+  //
+  // @brief: Take the whole due prefix of the queue (up to max_count) with one pop_until.
+  //    Tasks that are not due yet stay in the queue instead of being handed to the Executor
+  //    early, at the price of polling until they are.
+  //
+  template <ConcurrentPendingQueue Q, typename Container>
+    requires BatchPendingQueue<Q>
+  size_t pop_batch(Q &queue, const std::atomic_bool &stop, Container &out, size_t max_count)
+  {
+    const size_t popped = queue.pop_until(Clk::now(), out, max_count);
+    if (popped == 0)
+    {
+      std::this_thread::yield();
+    }
+    return popped;
+  }
+
+  template <ConcurrentPendingQueue Q>
+  void stop(Q &queue)
+  {
+    queue.clear();
+  }
+};
+
+//
+// PeekingWait: Version-1 locking without the polling. The queue still locks itself, but
+// publishes its earliest time_point (peek_deadline), so a worker can tell without any lock
+// whether something is due: it pops only due Tasks, and otherwise sleeps on a
+// condition_variable until the earliest time_point.
+//
+// The mutex only pairs the sleep with the wake-up: a producer takes it (and notifies) only
+// when its Task became the earliest one, since every sleeping worker wakes up at or before
+// the earliest time_point anyway. Producers inserting deeper in the queue never touch it.
+//
+template <Clock Clk = SteadyClock>
+class PeekingWait
+{
+public:
+  using clock_type = Clk;
+
+  template <PeekablePendingQueue Q>
+  void push(Q &queue, TimePointTask &&task)
+  {
+    if (queue.insert(std::move(task)))
+    {
+      {
+        // Empty critical section: a worker that peeked the old earliest time_point under
+        // mutex_ is waiting on cv_ by the time we get the mutex.
+        std::lock_guard<std::mutex> lock(mutex_);
+      }
+      cv_.notify_one();
+    }
+  }
+
+  template <PeekablePendingQueue Q>
+  std::optional<TimePointTask> pop(Q &queue, const std::atomic_bool &stop)
+  {
+    std::vector<TimePointTask> out;
+    if (pop_batch(queue, stop, out, 1) == 0)
+    {
+      return std::nullopt;
+    }
+    return std::move(out.front());
+  }
+
+  //
+  // @brief: Sleep until the earliest Task is due, then take every due Task (up to max_count)
+  //    with one pop_until. If due Tasks are left behind another worker is woken up.
+  //
+  template <PeekablePendingQueue Q, typename Container>
+  size_t pop_batch(Q &queue, const std::atomic_bool &stop, Container &out, size_t max_count)
+  {
+    while (!stop.load())
+    {
+      const Task::time_point_t now = Clk::now();
+      const std::optional<Task::time_point_t> earliest = queue.peek_deadline();
+      if (earliest && *earliest <= now)
+      {
+        const size_t popped = queue.pop_until(now, out, max_count);
+        if (popped == 0)
+        {
+          continue; // Another worker was first
+        }
+        const std::optional<Task::time_point_t> next = queue.peek_deadline();
+        if (next && *next <= now)
+        {
+          cv_.notify_one();
+        }
+        return popped;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (stop.load() || queue.peek_deadline() != earliest)
+      {
+        continue; // Changed while we were not holding mutex_: look again
+      }
+      if (earliest)
+      {
+        Clk::wait_until(cv_, lock, *earliest);
+      }
+      else
+      {
+        Clk::wait(cv_, lock);
+      }
+    }
+    return 0;
+  }
+
+  //
+  // @brief: time_point of the earliest Task, std::nullopt if the queue is empty. No lock.
+  //
+  template <PeekablePendingQueue Q>
+  std::optional<Task::time_point_t> next_deadline(Q &queue)
+  {
+    return queue.peek_deadline();
+  }
+
+  template <PeekablePendingQueue Q>
+  void stop(Q &queue)
+  {
+    queue.clear();
+    wake();
+  }
+
+  //
+  // @brief: Wake every worker up so it re-checks its stop flag. The queue is left alone.
+  //
+  void wake()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+    }
+    cv_.notify_all();
+  }
+
+private:
+  std::mutex mutex_; // Pairs the sleep of the workers with the wake-up by the producers
+  std::condition_variable cv_; // Signaled when the earliest time_point moved forward, or on stop
+};
+} // namespace job_manager
+} // namespace vm